@@ -8,55 +8,291 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
-#include <unordered_map>
 #include <utility>
-#include <atomic>
-#include <mutex>
+#include <tuple>
 #include <cctype>
+#include <cstring>
+#include <cstddef>
+#include <new>
 #include <stdint.h>
 #include <type_traits>
-#include <functional>
 #include <memory>
+#include <memory_resource>
 
 #include <iostream>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 // Use the RPOCO macro within a compound definition to create
 // automatic serialization information upon the specified members.
-// RPOCO has thread safe typeinfo init (double checked lock) so using
-// functions dependant of the functionality from multiple threads should
-// be safe.
+// The type information is a constant table built at compile time
+// (see rpoco::type_info_of) so there is no runtime init, locking
+// or allocation involved when using it from multiple threads.
 
 // Note 1: The macro magic below is necessary to unpack the field data and provide a coherent interface
-// Note 2: This lib uses ptrdiffed offsets to place fields at runtime
+// Note 2: Fields are addressed with member pointers, the enclosing type is passed in as rpoco_T
+//         since the class is still incomplete inside of the macro.
+// Note 3: A maximum of 64 members can be specified to a single RPOCO macro.
 
 #define RPOCO(...) \
-	void rpoco_type_info_expand(rpoco::type_info *ti,std::vector<std::string>& names,int idx) {} \
-	template<typename H,typename... R> \
-	void rpoco_type_info_expand(rpoco::type_info *ti,std::vector<std::string>& names,int idx,H& head,R&... rest) {\
-		ptrdiff_t off=(ptrdiff_t) (  ((uintptr_t)&head)-((uintptr_t)this) ); \
-		ti->add(new rpoco::field< std::remove_reference<H>::type >(names[idx],off) );\
-		rpoco_type_info_expand(ti,names,idx+1,rest...); \
-	} \
-	rpoco::type_info* rpoco_type_info_get() { \
-		static rpoco::type_info ti; \
-		if(!ti.is_init()) { \
-			ti.init([this](rpoco::type_info *ti) { \
-				std::vector<std::string> names=rpoco::extract_macro_names(#__VA_ARGS__); \
-				rpoco_type_info_expand(ti,names,0,__VA_ARGS__); \
-			} ); \
-		} \
-		return &ti; \
-	}
+	template<typename rpoco_T> struct rpoco_info { \
+		static constexpr const char *names[]={ RPOCO_FOR_EACH(RPOCO_NAME,__VA_ARGS__) }; \
+		typedef rpoco::field_list< RPOCO_FOR_EACH(RPOCO_FIELD,__VA_ARGS__) > fields; \
+	};
+
+#define RPOCO_NAME(m) #m
+#define RPOCO_FIELD(m) rpoco::field<&rpoco_T::m>
+
+// preprocessor helpers to apply a macro to each of the RPOCO arguments
+#define RPOCO_EXPAND(x) x
+#define RPOCO_CAT(a,b) RPOCO_CAT_I(a,b)
+#define RPOCO_CAT_I(a,b) a##b
+#define RPOCO_NARG(...) RPOCO_EXPAND(RPOCO_ARG_N(__VA_ARGS__,64,63,62,61,60,59,58,57,56,55,54,53,52,51,50,49,48,47,46,45,44,43,42,41,40,39,38,37,36,35,34,33,32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1))
+#define RPOCO_ARG_N(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32,_33,_34,_35,_36,_37,_38,_39,_40,_41,_42,_43,_44,_45,_46,_47,_48,_49,_50,_51,_52,_53,_54,_55,_56,_57,_58,_59,_60,_61,_62,_63,_64,N,...) N
+#define RPOCO_FOR_EACH(M,...) RPOCO_EXPAND(RPOCO_CAT(RPOCO_FE_,RPOCO_NARG(__VA_ARGS__))(M,__VA_ARGS__))
+#define RPOCO_FE_1(M,a) M(a)
+#define RPOCO_FE_2(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_1(M,__VA_ARGS__))
+#define RPOCO_FE_3(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_2(M,__VA_ARGS__))
+#define RPOCO_FE_4(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_3(M,__VA_ARGS__))
+#define RPOCO_FE_5(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_4(M,__VA_ARGS__))
+#define RPOCO_FE_6(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_5(M,__VA_ARGS__))
+#define RPOCO_FE_7(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_6(M,__VA_ARGS__))
+#define RPOCO_FE_8(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_7(M,__VA_ARGS__))
+#define RPOCO_FE_9(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_8(M,__VA_ARGS__))
+#define RPOCO_FE_10(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_9(M,__VA_ARGS__))
+#define RPOCO_FE_11(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_10(M,__VA_ARGS__))
+#define RPOCO_FE_12(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_11(M,__VA_ARGS__))
+#define RPOCO_FE_13(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_12(M,__VA_ARGS__))
+#define RPOCO_FE_14(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_13(M,__VA_ARGS__))
+#define RPOCO_FE_15(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_14(M,__VA_ARGS__))
+#define RPOCO_FE_16(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_15(M,__VA_ARGS__))
+#define RPOCO_FE_17(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_16(M,__VA_ARGS__))
+#define RPOCO_FE_18(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_17(M,__VA_ARGS__))
+#define RPOCO_FE_19(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_18(M,__VA_ARGS__))
+#define RPOCO_FE_20(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_19(M,__VA_ARGS__))
+#define RPOCO_FE_21(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_20(M,__VA_ARGS__))
+#define RPOCO_FE_22(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_21(M,__VA_ARGS__))
+#define RPOCO_FE_23(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_22(M,__VA_ARGS__))
+#define RPOCO_FE_24(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_23(M,__VA_ARGS__))
+#define RPOCO_FE_25(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_24(M,__VA_ARGS__))
+#define RPOCO_FE_26(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_25(M,__VA_ARGS__))
+#define RPOCO_FE_27(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_26(M,__VA_ARGS__))
+#define RPOCO_FE_28(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_27(M,__VA_ARGS__))
+#define RPOCO_FE_29(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_28(M,__VA_ARGS__))
+#define RPOCO_FE_30(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_29(M,__VA_ARGS__))
+#define RPOCO_FE_31(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_30(M,__VA_ARGS__))
+#define RPOCO_FE_32(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_31(M,__VA_ARGS__))
+#define RPOCO_FE_33(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_32(M,__VA_ARGS__))
+#define RPOCO_FE_34(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_33(M,__VA_ARGS__))
+#define RPOCO_FE_35(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_34(M,__VA_ARGS__))
+#define RPOCO_FE_36(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_35(M,__VA_ARGS__))
+#define RPOCO_FE_37(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_36(M,__VA_ARGS__))
+#define RPOCO_FE_38(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_37(M,__VA_ARGS__))
+#define RPOCO_FE_39(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_38(M,__VA_ARGS__))
+#define RPOCO_FE_40(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_39(M,__VA_ARGS__))
+#define RPOCO_FE_41(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_40(M,__VA_ARGS__))
+#define RPOCO_FE_42(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_41(M,__VA_ARGS__))
+#define RPOCO_FE_43(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_42(M,__VA_ARGS__))
+#define RPOCO_FE_44(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_43(M,__VA_ARGS__))
+#define RPOCO_FE_45(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_44(M,__VA_ARGS__))
+#define RPOCO_FE_46(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_45(M,__VA_ARGS__))
+#define RPOCO_FE_47(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_46(M,__VA_ARGS__))
+#define RPOCO_FE_48(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_47(M,__VA_ARGS__))
+#define RPOCO_FE_49(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_48(M,__VA_ARGS__))
+#define RPOCO_FE_50(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_49(M,__VA_ARGS__))
+#define RPOCO_FE_51(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_50(M,__VA_ARGS__))
+#define RPOCO_FE_52(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_51(M,__VA_ARGS__))
+#define RPOCO_FE_53(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_52(M,__VA_ARGS__))
+#define RPOCO_FE_54(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_53(M,__VA_ARGS__))
+#define RPOCO_FE_55(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_54(M,__VA_ARGS__))
+#define RPOCO_FE_56(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_55(M,__VA_ARGS__))
+#define RPOCO_FE_57(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_56(M,__VA_ARGS__))
+#define RPOCO_FE_58(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_57(M,__VA_ARGS__))
+#define RPOCO_FE_59(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_58(M,__VA_ARGS__))
+#define RPOCO_FE_60(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_59(M,__VA_ARGS__))
+#define RPOCO_FE_61(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_60(M,__VA_ARGS__))
+#define RPOCO_FE_62(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_61(M,__VA_ARGS__))
+#define RPOCO_FE_63(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_62(M,__VA_ARGS__))
+#define RPOCO_FE_64(M,a,...) M(a),RPOCO_EXPAND(RPOCO_FE_63(M,__VA_ARGS__))
 
 // Actual rpoco namespace containing member information and templates for iteration
 namespace rpoco {
 	class member;
-	class member_provider;
+	class type_info;
+	template<typename T> const type_info& type_info_of();
 
 	struct niltarget {};
 
+	// a view of raw bytes, visited like a string_view (the bytes
+	// are referenced and not owned by the span)
+	struct byte_span {
+		const uint8_t *data=0;
+		size_t size=0;
+	};
+
+	// new and delete as a memory resource, std::pmr::new_delete_resource
+	// always uses the aligned operators that are a lot slower with some
+	// mallocs so the plain ones are used for the usual alignments.
+	class heap_resource : public std::pmr::memory_resource {
+	protected:
+		void* do_allocate(size_t sz,size_t align) override {
+			if (align<=__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				return ::operator new(sz);
+			return ::operator new(sz,std::align_val_t(align));
+		}
+		void do_deallocate(void *p,size_t,size_t align) override {
+			if (align<=__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				::operator delete(p);
+			else
+				::operator delete(p,std::align_val_t(align));
+		}
+		bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+			return this==&o;
+		}
+	public:
+		static heap_resource* shared() {
+			static heap_resource res;
+			return &res;
+		}
+	};
+
+	// a simple chunked bump allocator, memory allocated from the arena
+	// is only released when the arena is reset or destroyed. The arena is
+	// also a memory resource so that pmr containers can allocate from it,
+	// chunks are taken from the upstream resource.
+	class arena : public std::pmr::memory_resource {
+		struct chunk {
+			chunk *next;
+			size_t size;
+		};
+		chunk *m_chunks=0;
+		char *m_cur=0;
+		char *m_end=0;
+		size_t m_chunk_size;
+		std::pmr::memory_resource *m_upstream;
+		void release(chunk *c) {
+			while(c) {
+				chunk *next=c->next;
+				m_upstream->deallocate(c,sizeof(chunk)+c->size,alignof(chunk));
+				c=next;
+			}
+		}
+	protected:
+		void* do_allocate(size_t sz,size_t align) override {
+			return allocate(sz,align);
+		}
+		// individual deallocations are ignored, everything goes at reset
+		void do_deallocate(void*,size_t,size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+			return this==&o;
+		}
+	public:
+		arena(size_t chunk_size=4096,std::pmr::memory_resource *upstream=heap_resource::shared()) : m_chunk_size(chunk_size),m_upstream(upstream) {}
+		arena(const arena&)=delete;
+		arena& operator=(const arena&)=delete;
+		~arena() {
+			release(m_chunks);
+		}
+		using std::pmr::memory_resource::allocate;
+		void* allocate(size_t sz,size_t align=alignof(std::max_align_t)) {
+			uintptr_t p=((uintptr_t)m_cur+align-1)&~(uintptr_t)(align-1);
+			if (!m_cur || p+sz>(uintptr_t)m_end) {
+				// grow with a new chunk, chunk sizes double to keep the chunk count low
+				size_t csz=m_chunks ? m_chunks->size*2 : m_chunk_size;
+				if (csz<sz+align)
+					csz=sz+align;
+				chunk *c=(chunk*)m_upstream->allocate(sizeof(chunk)+csz,alignof(chunk));
+				c->next=m_chunks;
+				c->size=csz;
+				m_chunks=c;
+				m_cur=(char*)(c+1);
+				m_end=m_cur+csz;
+				p=((uintptr_t)m_cur+align-1)&~(uintptr_t)(align-1);
+			}
+			m_cur=(char*)(p+sz);
+			return (void*)p;
+		}
+		// copy a string into the arena
+		std::string_view store(std::string_view str) {
+			char *p=(char*)allocate(str.size(),1);
+			memcpy(p,str.data(),str.size());
+			return std::string_view(p,str.size());
+		}
+		// release all allocations, the latest (and largest) chunk is kept for reuse.
+		void reset() {
+			if (!m_chunks)
+				return;
+			release(m_chunks->next);
+			m_chunks->next=0;
+			m_cur=(char*)(m_chunks+1);
+			m_end=m_cur+m_chunks->size;
+		}
+	};
+
+	// an upstream resource for arenas with large chunks, on Linux blocks of
+	// 2MB or more are mapped directly and marked as huge page candidates to
+	// cut TLB misses when walking big documents. Smaller blocks (and other
+	// platforms) use the heap.
+	class huge_page_resource : public std::pmr::memory_resource {
+		static constexpr size_t huge_size=2*1024*1024;
+	protected:
+		void* do_allocate(size_t sz,size_t align) override {
+#ifdef __linux__
+			if (sz>=huge_size) {
+				void *p=mmap(0,sz,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+				if (p==MAP_FAILED)
+					throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+				madvise(p,sz,MADV_HUGEPAGE);
+#endif
+				return p;
+			}
+#endif
+			return heap_resource::shared()->allocate(sz,align);
+		}
+		void do_deallocate(void *p,size_t sz,size_t align) override {
+#ifdef __linux__
+			if (sz>=huge_size) {
+				munmap(p,sz);
+				return;
+			}
+#endif
+			heap_resource::shared()->deallocate(p,sz,align);
+		}
+		bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+			return this==&o;
+		}
+	public:
+		static huge_page_resource* shared() {
+			static huge_page_resource res;
+			return &res;
+		}
+	};
+
+	// FNV-1a hashing of member names.
+	constexpr uint64_t hash_seed=0xcbf29ce484222325ULL;
+	constexpr uint64_t hash_step(uint64_t h,char c) {
+		return (h^(uint8_t)c)*0x100000001b3ULL;
+	}
+	constexpr uint64_t hash_name(std::string_view n) {
+		uint64_t h=hash_seed;
+		for (size_t i=0;i<n.size();i++)
+			h=hash_step(h,n[i]);
+		return h;
+	}
+
+	// a member name as passed to consumers, the name is only hashed by
+	// the lookups that need it (see type_info::find).
+	struct name_ref {
+		std::string_view name;
+		name_ref(std::string_view n) : name(n) {}
+	};
+
 	// visitation is done in a similar way both during creation (deserialization) and querying (serialization)
 	// vt_none is the result any querying system should provide when calling peek on the visitor while
 	// creation routines should provide the type of the next data item to be input/read/creation.
@@ -71,10 +307,24 @@ namespace rpoco {
 		vt_string
 	};
 
+	// non-owning reference to a consumer callback, unlike std::function this never
+	// allocates. The referenced callable must outlive the reference (consume
+	// callbacks are only called during the consume call).
+	class consume_fn {
+		void *m_obj;
+		void (*m_call)(void *obj,const name_ref &n);
+	public:
+		template<typename G,typename=typename std::enable_if<!std::is_same<typename std::decay<G>::type,consume_fn>::value>::type>
+		consume_fn(G &&g) : m_obj((void*)&g),m_call([](void *obj,const name_ref &n) { (*(typename std::remove_reference<G>::type*)obj)(n); }) {}
+		void operator()(const name_ref &n) const {
+			m_call(m_obj,n);
+		}
+	};
+
 	// subclass this type to enumerate data structures.
 	struct visitor {
 		virtual visit_type peek()=0; // return vt_none if querying objects, otherwise return the next data type.
-		virtual bool consume(visit_type vt,std::function<void(std::string&)> out)=0; // used by members to start consuming data from complex input objects during creation
+		virtual bool consume(visit_type vt,consume_fn out)=0; // used by members to start consuming data from complex input objects during creation
 		virtual void produce_start(visit_type vt)=0; // used to start producing complex objects
 		virtual void produce_end(visit_type vt)=0; // used to stop a production
 		// the primitive types below are just visited the same way during both reading and creation
@@ -84,25 +334,400 @@ namespace rpoco {
 		virtual void visit(double& x)=0;
 		virtual void visit(std::string &k)=0; // 
 		virtual void visit(char *,size_t sz)=0;
+		// string views are produced directly and during creation they
+		// will reference memory owned by the visitor (or its input)
+		virtual void visit(std::string_view &sv)=0;
+		// used to produce member names of objects, visitors that can write the name
+		// directly from the type info should override this to avoid the copy.
+		virtual void produce_name(std::string_view name) {
+			std::string tmp(name);
+			visit(tmp);
+		}
+		// used to produce the name of member I of the RPOCO type T, concrete visitors
+		// can hide this with a version using precomputed per type data.
+		template<typename T,size_t I> void produce_member();
+		// called before producing member idx of the object obj described by ti,
+		// visitors that leave out some members (like default values) return
+		// true to skip it.
+		virtual bool omit_member(const type_info &ti,size_t idx,void *obj) {
+			return false;
+		}
+		// the same for member I of the RPOCO type T, concrete visitors can
+		// hide this with a statically dispatched version.
+		template<typename T,size_t I> bool omit_member(T &t);
+		// memory resource for containers and strings created during consumption,
+		// visitors parsing into an arena return it so that pmr containers
+		// and json_value trees are allocated from there.
+		virtual std::pmr::memory_resource* memory_resource() {
+			return 0;
+		}
+		// visitors return true to produce objects described by ti positionally,
+		// as an array of the member values in declaration order.
+		virtual bool produce_positional(const type_info &ti) {
+			return false;
+		}
+		// the same for the RPOCO type T, can be hidden like omit_member
+		template<typename T> bool produce_positional();
+		// visitors return true to produce a vector of objects described by ti
+		// as a table, the visitor then produces the start of an object and the
+		// header of the table up to the member holding the rows. The rows follow
+		// as an array of positional objects and the object is ended after them.
+		virtual bool produce_columns(const type_info &ti) {
+			return false;
+		}
+	};
+
+	// class member description, gives a name and a visitation thunk for the member.
+	// instances are constant data created by the type_info_of template below.
+	class member {
+		std::string_view m_name;
+		uint64_t m_hash;
+		void (*m_visit)(visitor &v,void *p);
+		bool (*m_is_default)(const void *p);
+	public:
+		constexpr member(const char *name,void (*visitfn)(visitor &v,void *p),bool (*defaultfn)(const void *p)) : m_name(name),m_hash(hash_name(name)),m_visit(visitfn),m_is_default(defaultfn) {}
+		constexpr std::string_view name() const {
+			return m_name;
+		}
+		constexpr uint64_t hash() const {
+			return m_hash;
+		}
+		void visit(visitor &v,void *p) const {
+			m_visit(v,p);
+		}
+		// check if the member of the object p is equal to the member of a
+		// default constructed object (see default_compare below)
+		bool is_default(const void *p) const {
+			return m_is_default(p);
+		}
+	};
+
+	// map a name hash (rehashed by a displacement) to a slot in a table of n entries
+	constexpr uint32_t hash_slot(uint64_t h,uint32_t d,uint32_t n) {
+		h+=d*0x9e3779b97f4a7c15ULL;
+		h^=h>>33;
+		h*=0xff51afd7ed558ccdULL;
+		h^=h>>33;
+		return (uint32_t)(((h>>32)*n)>>32);
+	}
+
+	// minimal perfect hash over the member names of a type (hash and displace).
+	// the names are first hashed to a bucket, every bucket then has a displacement
+	// value that maps the names of that bucket to distinct free slots. buckets with a
+	// single name stores the slot directly as a negative value.
+	template<size_t N> struct perfect_hash {
+		int32_t disp[N]={};
+		uint8_t slots[N]={};
+	};
+	template<size_t N> constexpr perfect_hash<N> make_perfect_hash(const member (&members)[N]) {
+		perfect_hash<N> ph;
+		uint32_t bucket[N]={};
+		uint32_t bucket_size[N]={};
+		bool used[N]={};
+		for (size_t i=0;i<N;i++) {
+			bucket[i]=hash_slot(members[i].hash(),0,N);
+			bucket_size[bucket[i]]++;
+		}
+		// place the multi-name buckets first, largest first since they're the hardest to fit.
+		for (uint32_t sz=N;sz>1;sz--) {
+			for (uint32_t b=0;b<N;b++) {
+				if (bucket_size[b]!=sz)
+					continue;
+				for (uint32_t d=1;;d++) {
+					if (d>(1<<20))
+						throw "rpoco: could not build a perfect hash (duplicate member names?)";
+					bool fits=true;
+					bool taken[N]={};
+					for (size_t i=0;i<N && fits;i++) {
+						if (bucket[i]!=b)
+							continue;
+						uint32_t s=hash_slot(members[i].hash(),d,N);
+						fits=!used[s] && !taken[s];
+						taken[s]=true;
+					}
+					if (!fits)
+						continue;
+					for (size_t i=0;i<N;i++) {
+						if (bucket[i]!=b)
+							continue;
+						uint32_t s=hash_slot(members[i].hash(),d,N);
+						used[s]=true;
+						ph.slots[s]=(uint8_t)i;
+					}
+					ph.disp[b]=(int32_t)d;
+					break;
+				}
+			}
+		}
+		// single name buckets just take the next free slot.
+		uint32_t free_slot=0;
+		for (size_t i=0;i<N;i++) {
+			if (bucket_size[bucket[i]]!=1)
+				continue;
+			while(used[free_slot])
+				free_slot++;
+			used[free_slot]=true;
+			ph.slots[free_slot]=(uint8_t)i;
+			ph.disp[bucket[i]]=-(int32_t)free_slot-1;
+		}
+		return ph;
+	}
+
+	// type_info is the member table for regular classes.
+	class type_info {
+		const member *m_members;
+		int m_size;
+		const int32_t *m_disp;
+		const uint8_t *m_slots;
+		bool m_positional;
+	public:
+		constexpr type_info(const member *members,int size,const int32_t *disp,const uint8_t *slots,bool positional) : m_members(members),m_size(size),m_disp(disp),m_slots(slots),m_positional(positional) {}
+		int size() const {
+			return m_size;
+		}
+		// true if the type is always produced positionally (see positional_encoding)
+		bool positional() const {
+			return m_positional;
+		}
+		// get an indexed member (0-size() are valid indexes)
+		const member& operator[](int idx) const {
+			return m_members[idx];
+		}
+		// get a named member with a single probe of the perfect hash,
+		// returns null if the member does not exist
+		const member* find(const name_ref &id) const {
+			uint64_t h=hash_name(id.name);
+			int32_t d=m_disp[hash_slot(h,0,m_size)];
+			const member *m=m_members+m_slots[d<0 ? -d-1 : hash_slot(h,d,m_size)];
+			if (m->hash()!=h || m->name().size()!=id.name.size() || memcmp(m->name().data(),id.name.data(),id.name.size()))
+				return 0;
+			return m;
+		}
+	};
+
+	// get the owner and member types out of a member pointer type
+	template<typename M> struct member_pointer_traits;
+	template<typename C,typename F> struct member_pointer_traits<F C::*> {
+		typedef C owner;
+		typedef F type;
+	};
+
+	// the visitation template, F is the type visited and V the visitor type.
+	// V defaults to the abstract visitor so custom visitors can be used through
+	// virtual calls, instantiating the templates with a concrete (final) visitor
+	// type instead makes all visitation statically dispatched and inlinable.
+	// Note: specializations should be partial over V so they're used regardless of visitor.
+	template<typename F,typename V=visitor> struct visit;
+
+	// value comparison of members with the members of default constructed
+	// objects (used to omit defaults), types that cannot be compared are
+	// never considered default.
+	template<typename F,typename=void> struct default_compare {
+		static bool equal(const F &,const F &) {
+			return false;
+		}
+	};
+	template<typename F> struct default_compare<F,typename std::enable_if<std::is_integral<F>::value || std::is_pointer<F>::value>::type> {
+		static bool equal(const F &a,const F &b) {
+			return a==b;
+		}
+	};
+	// bitwise so that -0 is not omitted in favour of 0
+	template<> struct default_compare<double> {
+		static bool equal(const double &a,const double &b) {
+			return !memcmp(&a,&b,sizeof(double));
+		}
+	};
+	template<> struct default_compare<std::string> {
+		static bool equal(const std::string &a,const std::string &b) {
+			return a==b;
+		}
+	};
+	template<> struct default_compare<std::string_view> {
+		static bool equal(const std::string_view &a,const std::string_view &b) {
+			return a==b;
+		}
+	};
+	template<> struct default_compare<byte_span> {
+		static bool equal(const byte_span &a,const byte_span &b) {
+			return a.size==b.size && (!a.size || !memcmp(a.data,b.data,a.size));
+		}
+	};
+	template<size_t SZ> struct default_compare<char[SZ]> {
+		static bool equal(const char (&a)[SZ],const char (&b)[SZ]) {
+			return !strncmp(a,b,SZ);
+		}
+	};
+	template<typename E> struct default_compare<std::shared_ptr<E>> {
+		static bool equal(const std::shared_ptr<E> &a,const std::shared_ptr<E> &b) {
+			return a==b;
+		}
+	};
+	template<typename E> struct default_compare<std::unique_ptr<E>> {
+		static bool equal(const std::unique_ptr<E> &a,const std::unique_ptr<E> &b) {
+			return a==b;
+		}
+	};
+	template<typename E,typename A> struct default_compare<std::vector<E,A>> {
+		static bool equal(const std::vector<E,A> &a,const std::vector<E,A> &b) {
+			if (a.size()!=b.size())
+				return false;
+			for (size_t i=0;i<a.size();i++)
+				if (!default_compare<E>::equal(a[i],b[i]))
+					return false;
+			return true;
+		}
+	};
+	template<typename E> struct default_compare<std::map<std::string,E>> {
+		static bool equal(const std::map<std::string,E> &a,const std::map<std::string,E> &b) {
+			if (a.size()!=b.size())
+				return false;
+			for (auto ia=a.begin(),ib=b.begin();ia!=a.end();++ia,++ib)
+				if (ia->first!=ib->first || !default_compare<E>::equal(ia->second,ib->second))
+					return false;
+			return true;
+		}
+	};
+	// the default constructed object that members are compared with
+	template<typename T> const T& default_object() {
+		static const T def{};
+		return def;
+	}
+
+	// specialize this as std::true_type to always produce a RPOCO type positionally
+	template<typename T> struct positional_encoding : std::false_type {};
+
+	// field class template for the actual members (see the RPOCO macro for usage),
+	// M is a member pointer to the field in the owning class.
+	template<auto M>
+	struct field {
+		typedef typename member_pointer_traits<decltype(M)>::owner owner;
+		typedef typename member_pointer_traits<decltype(M)>::type type;
+		static constexpr auto pointer=M;
+		static type& get(void *p) {
+			return static_cast<owner*>(p)->*M;
+		}
+		template<typename V> static void visit(V &v,void *p) {
+			rpoco::visit<type,V>(v,get(p));
+		}
+		// compare the member of the object p with the member of a default
+		// constructed object, members of other objects are never default
+		static bool is_default(const void *p) {
+			if constexpr (std::is_default_constructible<owner>::value)
+				return default_compare<type>::equal(get((void*)p),default_object<owner>().*M);
+			else
+				return false;
+		}
+	};
+
+	// type list of fields produced by the RPOCO macro
+	template<typename... Fs> struct field_list {};
+
+	// member visitation thunk for a visitor type
+	template<typename V> using visit_thunk=void (*)(V &v,void *p);
+
+	// the constant member tables, the tables only depend on constant
+	// data so they are initialized at compile time without any locking.
+	template<typename T,typename FL,typename IS> struct type_info_table;
+	template<typename T,typename... Fs,size_t... I> struct type_info_table<T,field_list<Fs...>,std::index_sequence<I...>> {
+		typedef typename T::template rpoco_info<T> info;
+		static constexpr member members[sizeof...(Fs)]={ member(info::names[I],&Fs::template visit<visitor>,&Fs::is_default)... };
+		static constexpr perfect_hash<sizeof...(Fs)> ph=make_perfect_hash(members);
+		static constexpr type_info ti=type_info(members,sizeof...(Fs),ph.disp,ph.slots,positional_encoding<T>::value);
+		// the field type of member N
+		template<size_t N> using field_at=typename std::tuple_element<N,std::tuple<Fs...>>::type;
+		// member visitation thunks instantiated for a specific visitor type
+		template<typename V> static constexpr visit_thunk<V> thunks[sizeof...(Fs)]={ &Fs::template visit<V>... };
+		// produce all members in order, expanded at compile time so the
+		// visitation of each member can be inlined.
+		template<typename V> static void produce(V &v,T &t) {
+			((v.template omit_member<T,I>(t) || (v.template produce_member<T,I>(),rpoco::visit<typename Fs::type,V>(v,t.*Fs::pointer),false)),...);
+		}
+		// produce only the member values in order for positional objects
+		template<typename V> static void produce_values(V &v,T &t) {
+			(rpoco::visit<typename Fs::type,V>(v,t.*Fs::pointer),...);
+		}
+	};
+
+	// the table type of a RPOCO type
+	template<typename T> using type_info_table_of=type_info_table<
+		T,
+		typename T::template rpoco_info<T>::fields,
+		std::make_index_sequence<sizeof(T::template rpoco_info<T>::names)/sizeof(const char*)>>;
+
+	// check if a type has RPOCO type info
+	template<typename T,typename=void> struct is_rpoco : std::false_type {};
+	template<typename T> struct is_rpoco<T,std::void_t<typename T::template rpoco_info<T>>> : std::true_type {};
+
+	// get the type info of a RPOCO type without needing an instance
+	template<typename T> const type_info& type_info_of() {
+		return type_info_table_of<T>::ti;
+	}
+
+	template<typename T,size_t I> void visitor::produce_member() {
+		produce_name(type_info_table_of<T>::members[I].name());
+	}
+	template<typename T,size_t I> bool visitor::omit_member(T &t) {
+		return omit_member(type_info_table_of<T>::ti,I,(void*)&t);
+	}
+	template<typename T> bool visitor::produce_positional() {
+		return produce_positional(type_info_table_of<T>::ti);
+	}
+
+	// RPOCO objects are equal when all members are
+	template<typename F> struct default_compare<F,typename std::enable_if<is_rpoco<F>::value>::type> {
+		typedef type_info_table_of<F> table;
+		template<size_t... I> static bool members(const F &a,const F &b,std::index_sequence<I...>) {
+			return (default_compare<typename table::template field_at<I>::type>::equal(a.*table::template field_at<I>::pointer,b.*table::template field_at<I>::pointer) && ...);
+		}
+		static bool equal(const F &a,const F &b) {
+			return members(a,b,std::make_index_sequence<sizeof(table::members)/sizeof(member)>());
+		}
 	};
 
 	// generic class type visitation template functionality.
 	// if an object wants to override to handle multiple types a specialization
 	// of this template can be done, see rpoco::niltarget or rpocojson::json_value
-	template<typename F>
-	struct visit { visit(visitor &v,F &f) {
+	template<typename F,typename V>
+	struct visit { visit(V &v,F &f) {
+		typedef type_info_table_of<F> table;
 		// get member info of a rpoco object
-		member_provider *fp=f.rpoco_type_info_get();
+		const type_info &ti=table::ti;
+		// index of the member we expect to see next
+		int next=0;
+		// objects can also be read positionally from an array of member values
+		if (v.peek()==vt_array) {
+			v.consume(vt_array,[&v,&ti,&f,&next](const name_ref&) {
+				if (next<ti.size()) {
+					table::template thunks<V>[next](v,(void*)&f);
+				} else {
+					// ignore extra values
+					niltarget nt;
+					rpoco::visit<niltarget,V>(v,nt);
+				}
+				next++;
+			});
+			return;
+		}
 		// if reading then start consuming data
-		if (v.consume(vt_object,[&v,fp,&f](std::string& n){
+		if (v.consume(vt_object,[&v,&ti,&f,&next](const name_ref& n){
+				const member *m;
+				// data produced by rpoco usually has the members in declaration
+				// order so check the predicted member before doing a hash lookup
+				if (next<ti.size() && ti[next].name()==n.name)
+					m=&ti[next];
+				else
+					m=ti.find(n);
 				// check if the member to consume exists
-				if (! fp->has(n)) {
+				if (!m) {
 					// if not start the nil consumer
 					niltarget nt;
-					rpoco::visit<niltarget>(v,nt);
+					rpoco::visit<niltarget,V>(v,nt);
 				} else {
-					// visit member
-					(*fp)[n]->visit(v,(void*)&f);
+					// predict the member following this one and visit the member
+					int idx=(int)(m-&ti[0]);
+					next=idx+1;
+					table::template thunks<V>[idx](v,(void*)&f);
 				}
 			}))
 		{
@@ -111,21 +736,24 @@ namespace rpoco {
 		} else {
 			// we're in production mode so produce
 			// data from our members
-			v.produce_start(vt_object);
-			for (int i=0;i<fp->size();i++) {
-				v.visit((*fp)[i]->name());
-				(*fp)[i]->visit(v,(void*)&f);
+			if (v.template produce_positional<F>()) {
+				v.produce_start(vt_array);
+				table::produce_values(v,f);
+				v.produce_end(vt_array);
+			} else {
+				v.produce_start(vt_object);
+				table::produce(v,f);
+				v.produce_end(vt_object);
 			}
-			v.produce_end(vt_object);
 		}
 	}};
 
 	// map visitation
-	template<typename F>
-	struct visit<std::map<std::string,F>> { visit(visitor &v,std::map<std::string,F> &mp) {
-		if (v.consume(vt_object,[&v,&mp](std::string& x) {
+	template<typename F,typename V>
+	struct visit<std::map<std::string,F>,V> { visit(V &v,std::map<std::string,F> &mp) {
+		if (v.consume(vt_object,[&v,&mp](const name_ref& x) {
 				// just produce new entries during consumption
-				rpoco::visit<F>(v, mp[x] );
+				rpoco::visit<F,V>(v, mp[std::string(x.name)] );
 			}))
 		{
 			return;
@@ -133,9 +761,9 @@ namespace rpoco {
 			// production wanted, so produce all
 			// members to a target object.
 			v.produce_start(vt_object);
-			for (std::pair<std::string,F> p:mp) {
-				rpoco::visit<std::string>(v,p.first);
-				rpoco::visit<F>(v,p.second);
+			for (std::pair<const std::string,F> &p:mp) {
+				v.produce_name(p.first);
+				rpoco::visit<F,V>(v,p.second);
 			}
 			v.produce_end(vt_object);
 		}
@@ -144,8 +772,8 @@ namespace rpoco {
 	// nil visitor, this visitor
 	// can consume any type thrown at it and is used
 	// to ignore unknown incomming data
-	template<>
-	struct visit<niltarget> { visit(visitor &v,niltarget &nt) {
+	template<typename V>
+	struct visit<niltarget,V> { visit(V &v,niltarget &nt) {
 		visit_type vtn;
 		switch(vtn=v.peek()) {
 		case vt_null :
@@ -165,30 +793,60 @@ namespace rpoco {
 			} break;
 		case vt_array :
 		case vt_object : {
-				v.consume(vtn,[&v,&nt](std::string& propname) {
+				v.consume(vtn,[&v,&nt](const name_ref& propname) {
 					niltarget ntn;
 					//std::cout<<"Ignoring prop:"<<propname<<"\n";
-					rpoco::visit<niltarget>(v,ntn);
+					rpoco::visit<niltarget,V>(v,ntn);
 				});
 			} break;
 		}
 	}};
 
+	// empty pmr containers still on the default resource are re-created on the
+	// memory resource of the visitor (if any) before consumption, containers
+	// that were given a resource explicitly keep it.
+	template<typename C,typename A> void reseat(C &,std::pmr::memory_resource *,A*) {}
+	template<typename C,typename E> void reseat(C &c,std::pmr::memory_resource *mr,std::pmr::polymorphic_allocator<E>*) {
+		if (!mr || !c.empty() || c.get_allocator().resource()!=std::pmr::get_default_resource())
+			return;
+		c.~C();
+		new (&c) C(mr);
+	}
+	template<typename C> void reseat(C &c,std::pmr::memory_resource *mr) {
+		reseat(c,mr,(typename C::allocator_type*)0);
+	}
+
 	// vector visitor, used for arrays
-	template<typename F>
-	struct visit<std::vector<F>> { visit(visitor &v,std::vector<F> &vp) {
-		if (v.consume(vt_array,[&v,&vp](std::string& x) {
+	template<typename F,typename A,typename V>
+	struct visit<std::vector<F,A>,V> { visit(V &v,std::vector<F,A> &vp) {
+		if (v.peek()==vt_array)
+			reseat(vp,v.memory_resource());
+		if (v.consume(vt_array,[&v,&vp](const name_ref& x) {
 				// consumption of incoming data
 				vp.emplace_back();
-				rpoco::visit<F>(v,vp.back());
+				rpoco::visit<F,V>(v,vp.back());
 			}))
 		{
 			return ;
 		} else {
-			// production of outgoing data
+			// production of outgoing data, vectors of RPOCO objects
+			// can be produced as a table of positional rows
+			if constexpr (is_rpoco<F>::value) {
+				if (v.produce_columns(type_info_of<F>())) {
+					v.produce_start(vt_array);
+					for (F &f:vp) {
+						v.produce_start(vt_array);
+						type_info_table_of<F>::produce_values(v,f);
+						v.produce_end(vt_array);
+					}
+					v.produce_end(vt_array);
+					v.produce_end(vt_object);
+					return;
+				}
+			}
 			v.produce_start(vt_array);
 			for (F &f:vp) {
-				rpoco::visit<F>(v,f);
+				rpoco::visit<F,V>(v,f);
 			}
 			v.produce_end(vt_array);
 		}
@@ -198,165 +856,104 @@ namespace rpoco {
 	// the pointer visitor creates a new object of the specified type
 	// during consumption so destructors should
 	// always check for the presence and destroy if needed.
-	template<typename F>
-	struct visit<F*> { visit(visitor &v,F *& fp) {
+	template<typename F,typename V>
+	struct visit<F*,V> { visit(V &v,F *& fp) {
 		if (v.peek()!=vt_null && v.peek()!=vt_none && !fp) {
 			fp=new F();
 		}
 		if (fp)
-			visit<F>(v,*fp);
+			rpoco::visit<F,V>(v,*fp);
 		else
 			v.visit_null();
 	}};
 
 	// like the pointer consumer above the shared_ptr
 	// consumer will also create new objects to hold if needed.
-	template<typename F>
-	struct visit<std::shared_ptr<F>> { visit(visitor &v,std::shared_ptr<F> & fp) {
+	template<typename F,typename V>
+	struct visit<std::shared_ptr<F>,V> { visit(V &v,std::shared_ptr<F> & fp) {
 		if (v.peek()!=vt_null && v.peek()!=vt_none && !fp) {
 			fp.reset(new F());
 		}
 		if (fp)
-			visit<F>(v,*fp);
+			rpoco::visit<F,V>(v,*fp);
 		else
 			v.visit_null();
 	}};
 
 	// a unique_ptr version of the above shared_ptr template
-	template<typename F>
-	struct visit<std::unique_ptr<F>> { visit(visitor &v,std::unique_ptr<F> & fp) {
+	template<typename F,typename V>
+	struct visit<std::unique_ptr<F>,V> { visit(V &v,std::unique_ptr<F> & fp) {
 		if (v.peek()!=vt_null && v.peek()!=vt_none && !fp) {
 			fp.reset(new F());
 		}
 		if (fp)
-			visit<F>(v,*fp);
+			rpoco::visit<F,V>(v,*fp);
 		else
 			v.visit_null();
 	}};
 
 	// integer visitation
-	template<> struct visit<int> {
-		visit(visitor &v,int &ip) {
+	template<typename V> struct visit<int,V> {
+		visit(V &v,int &ip) {
 			v.visit(ip);
 		}
 	};
 
 	// double visitation
-	template<> struct visit<double> {
-		visit(visitor &v,double &ip) {
+	template<typename V> struct visit<double,V> {
+		visit(V &v,double &ip) {
 			v.visit(ip);
 		}
 	};
 
 	// string visitation
-	template<> struct visit<std::string> { visit(visitor &v,std::string &str) {
+	template<typename V> struct visit<std::string,V> { visit(V &v,std::string &str) {
 		v.visit(str);
 	}};
 
-	// sized C-string visitation
-	template<int SZ> struct visit<char[SZ]> { visit(visitor &v,char (&str)[SZ]) {
-		v.visit(str,SZ);
-	}};
-
-	// base class for class members, gives a name and provides an abstract visitation function
-	class member {
-	public:
-	protected:
-		std::string m_name;
-	public:
-		member(std::string name) {
-			this->m_name=name;
-		}
-		std::string& name() {
-			return m_name;
-		}
-		virtual void visit(visitor &v,void *p)=0;
-	};
-
-	// field class template for the actual members (see the RPOCO macro for usage)
-	template<typename F>
-	class field : public member {
-		ptrdiff_t m_offset;
-	public:
-		field(std::string name,ptrdiff_t off) : member(name) {
-			this->m_offset=off;
+	// pmr strings are read through a view so that the characters are copied
+	// once, straight into the resource of the string (or the visitor).
+	template<typename V> struct visit<std::pmr::string,V> { visit(V &v,std::pmr::string &str) {
+		if (v.peek()==vt_none) {
+			std::string_view sv(str);
+			v.visit(sv);
+			return;
 		}
-		ptrdiff_t offset() {
-			return m_offset;
+		if (v.peek()!=vt_string) {
+			std::string tmp;
+			v.visit(tmp);
+			return;
 		}
-		virtual void visit(visitor &v,void *p) {
-			rpoco::visit<F>(v,*(F*)( (uintptr_t)p+(ptrdiff_t)m_offset ));
+		reseat(str,v.memory_resource());
+		if (v.memory_resource()) {
+			// escaped strings are unescaped into the visitor resource
+			std::string_view sv;
+			v.visit(sv);
+			str.assign(sv.data(),sv.size());
+		} else {
+			std::string tmp;
+			v.visit(tmp);
+			str.assign(tmp);
 		}
-	};
+	}};
 
-	// a generic member provider class
-	class member_provider {
-	public:
-		virtual int size()=0; // number of members
-		virtual bool has(std::string id)=0; // do we have the requested member?
-		virtual member*& operator[](int idx)=0; // get an indexed member (0-size() are valid indexes)
-		virtual member*& operator[](std::string id)=0; // get a named member
-	};
+	// string view visitation, see the visitor regarding the ownership
+	template<typename V> struct visit<std::string_view,V> { visit(V &v,std::string_view &sv) {
+		v.visit(sv);
+	}};
 
-	// type_info is a member_provider implementation for regular classes.
-	class type_info : public member_provider {
-		std::vector<member*> fields;
-		std::unordered_map<std::string,member*> m_named_fields;
-		std::atomic<int> m_is_init;
-		std::mutex init_mutex;
-	public:
-		virtual int size() {
-			return fields.size();
-		}
-		virtual bool has(std::string id) {
-			return m_named_fields.end()!=m_named_fields.find(id);
-		}
-		virtual member*& operator[](int idx) {
-			return fields[idx];
-		}
-		virtual member*& operator[](std::string id) {
-			return m_named_fields[id];
-		}
-		int is_init() {
-			return m_is_init.load();
-		}
-		void init(std::function<void (type_info *ti)> initfun) {
-			std::lock_guard<std::mutex> lock(init_mutex);\
-			if (!m_is_init.load()) {
-				initfun(this);
-				m_is_init.store(1);
-			}
-		}
-		void add(member *fb) {
-			fields.push_back(fb);
-			m_named_fields[fb->name()]=fb;
-		}
-	};
+	// byte spans are visited as string views
+	template<typename V> struct visit<byte_span,V> { visit(V &v,byte_span &bs) {
+		std::string_view sv((const char*)bs.data,bs.size);
+		v.visit(sv);
+		bs.data=(const uint8_t*)sv.data();
+		bs.size=sv.size();
+	}};
 
-	// helper function to the RPOCO macro to parse the data
-	static std::vector<std::string> extract_macro_names(const char *t) {
-		// skip spaces and commas
-		while(*t&&(std::isspace(*t)||*t==',')) { t++; }
-		// token start pos
-		const char *s=t;
-		// the vector of output names
-		std::vector<std::string> out;
-		// small loop to extract tokens from non-space/comma characters
-		while(*t) {
-			if (*t==','||std::isspace(*t)) {
-				out.push_back(std::string(s,t-s));
-				// skip spaces and commas
-				while(*t&&(std::isspace(*t)||*t==',')) { t++; }
-				s=t;
-			} else {
-				t++;
-			}
-		}
-		// did we have an extra string? push it.
-		if (s!=t)
-			out.push_back(std::string(s,t-s));
-		return out;
-	}
+	// sized C-string visitation
+	template<size_t SZ,typename V> struct visit<char[SZ],V> { visit(V &v,char (&str)[SZ]) {
+		v.visit(str,SZ);
+	}};
 };
 
 #endif // __INCLUDED_RPOCO_HPP__
@@ -7,24 +7,119 @@
 #pragma once
 
 #include <rpoco/rpoco.hpp>
+#include <rpoco/rpocosimd.hpp>
+#include <rpoco/rpoconum.hpp>
 #include <iostream>
 #include <sstream>
+#include <iterator>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <atomic>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#endif
 
 namespace rpocojson {
 	// Functions to parse the istream or string into the templatized target
 	// these functions will return true if the parsing was successful.
+	// The string_view version parses directly from the callers memory.
 	// Optional support exists for the parser to skip over C/C++ style comments.
 	// By default UTF16 surrogate decoding is done so that the UTF8 strings
 	// has full codepoints instead of surrogate pairs.
-	template<typename X> bool parse(std::istream &in,X &x,bool allow_c_comments,bool utf16_to_utf8);
-	template<typename X> bool parse(std::string &str,X &x,bool allow_c_comments,bool utf16_to_utf8);
+	template<typename X> bool parse(std::istream &in,X &x,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	template<typename X> bool parse(std::string_view in,X &x,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	// Parsing with a parse_result lets std::string_view (and rpoco::byte_span) targets
+	// reference the parsed text directly, strings that needs decoding due to escapes
+	// are stored in the result. The result must be kept alive as long as the views are used.
+	// Without a result string views can only reference the string_view input and
+	// parsing fails if escaped strings are encountered.
+	class parse_result;
+	template<typename X> bool parse(std::string_view in,X &x,parse_result &result,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	template<typename X> bool parse(std::istream &in,X &x,parse_result &result,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	// Parsing with a memory resource (usually a rpoco::arena) allocates pmr strings,
+	// pmr vectors and json_value trees from it, decoded strings for string views
+	// are also stored there. Resources that free on deallocation (like new/delete)
+	// leak the decoded strings so use a monotonic one.
+	template<typename X> bool parse(std::string_view in,X &x,std::pmr::memory_resource &mr,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	template<typename X> bool parse(std::istream &in,X &x,std::pmr::memory_resource &mr,bool allow_c_comments = false,bool utf16_to_utf8 = true);
+	// Options controlling the parsing
+	struct parse_options {
+		bool allow_c_comments=false;
+		bool utf16_to_utf8=true;
+	};
+	// The same parsing functions taking the options
+	template<typename X> bool parse(std::string_view in,X &x,const parse_options &opts);
+	template<typename X> bool parse(std::istream &in,X &x,const parse_options &opts);
+	template<typename X> bool parse(std::string_view in,X &x,parse_result &result,const parse_options &opts);
+	template<typename X> bool parse(std::istream &in,X &x,parse_result &result,const parse_options &opts);
+	template<typename X> bool parse(std::string_view in,X &x,std::pmr::memory_resource &mr,const parse_options &opts);
+	template<typename X> bool parse(std::istream &in,X &x,std::pmr::memory_resource &mr,const parse_options &opts);
+	// Options controlling the JSON output
+	struct write_options {
+		// write non-ASCII characters as UTF8 instead of \u escapes,
+		// only quotes, backslashes and control characters are escaped.
+		bool raw_utf8=false;
+		// size of the blocks passed to output sinks
+		size_t block_size=64*1024;
+		// number of threads (including the calling thread) used to write large
+		// vectors and maps, the elements are written in chunks that are joined
+		// in order so the output is identical to writing on a single thread.
+		// The threads are started when first needed and kept for later calls.
+		unsigned threads=1;
+		// containers with fewer elements are always written on the calling thread
+		size_t parallel_min=1024;
+		// leave out members of RPOCO objects that are equal to the member of a
+		// default constructed object (the value of in-class initializers or
+		// value initialization). Parsing the output into default constructed
+		// objects gives back the original values since the parser leaves
+		// members that are not in the input untouched.
+		bool omit_defaults=false;
+		// write all RPOCO objects as arrays of their member values in declaration
+		// order (see rpoco::positional_encoding to enable it for specific types).
+		// The parser reads objects in either form, the reading side needs
+		// the same member declarations. Members are never omitted.
+		bool positional=false;
+		// write vectors of RPOCO objects as a single list of member names followed
+		// by rows of values, {"columns":["x","y"],"rows":[[1,2],[3,4]]}, instead
+		// of repeating the member names for every object. The parser detects
+		// this form automatically. Members are never omitted in the rows.
+		bool columnar=false;
+	};
 	// A function to convert an RPOCO compatible structure to a JSON string.
-	template<typename X> std::string to_json(X &x);
+	template<typename X> std::string to_json(X &x,const write_options &opts = write_options());
+	// Write into a caller owned string (replacing the contents), reusing the
+	// same string between calls avoids allocating a new output buffer each time.
+	template<typename X> void to_json(X &x,std::string &out,const write_options &opts = write_options());
+	// Streaming versions that pass the output to a sink in fixed-size blocks
+	// so that the whole document never needs to be in memory, these return
+	// false if the output failed.
+	struct json_sink;
+	template<typename X> bool to_json(X &x,json_sink &sink,const write_options &opts = write_options());
+	template<typename X> bool to_json(X &x,std::ostream &out,const write_options &opts = write_options());
+	// Write to a caller provided buffer, the return value is the size of the
+	// full JSON text (no terminator is written). If it is larger than the
+	// capacity the output was truncated and a buffer of that size is needed.
+	template<typename X> size_t to_json(X &x,char *buf,size_t capacity,const write_options &opts = write_options());
+	// Scatter-gather output where large strings that need no escaping are
+	// referenced instead of copied, the object must be kept alive and
+	// unchanged as long as the output is used.
+	class json_iovec;
+	template<typename X> void to_json(X &x,json_iovec &out,const write_options &opts = write_options());
 	// a catch-all class to read in arbitrary data from JSON fields.
 	class json_value;
+	// a compact read-only document, read in with the parser
+	class json_tape;
 
 	// create a UTF8 sequence from a unicode codepoint
 	// X is the type of our output
@@ -51,7 +146,9 @@ namespace rpocojson {
 			d.dmp(x,0xc0,c);
 		}
 	}
-	// decode a UTF8 sequence into a codepoint
+	// decode a UTF8 sequence into a codepoint, EOF is returned for malformed
+	// sequences (see rpoco::utf8_sequence). A byte that cannot continue the
+	// sequence is left in the input.
 	// X is our input stream type
 	template<typename X> int read_utf8(X &x) {
 		int out=x.get();
@@ -61,706 +158,1653 @@ namespace rpocojson {
 		if (!(out&0x80)) {
 			return out;
 		}
-		// start with continuation mask
-		int mask=0xc0;
-		// size the bitmask
-		while(mask!=0xff) {
-			if ( ((mask<<1)&0xff) == (out&mask) )
-				break; // is all bits but the lowest of the mask set?
-			mask|=mask>>1; // no match, widen the mask.
-		}
-		// invalid masks to read, too long or continuation mask
-		if (mask==0xff || mask==0xc0)
-			return EOF; // got a continuation byte or an filled mask, return error as EOF
-		out&=~mask;
-		// dump the UTF8 bytes
-		while(mask&0x20) {
-			int next=x.get();
-			if (next==EOF)
-				return EOF; // mid-character EOF, return EOF
-			if (0x80!=(next&0xc0))
-				return EOF; // EOF is extra char data isn't continuation.
+		// the number of continuation bytes and the smallest value for the length
+		int n,min;
+		if (out>=0xc2 && out<=0xdf) {
+			n=1;
+			min=0x80;
+			out&=0x1f;
+		} else if (out>=0xe0 && out<=0xef) {
+			n=2;
+			min=0x800;
+			out&=0x0f;
+		} else if (out>=0xf0 && out<=0xf4) {
+			n=3;
+			min=0x10000;
+			out&=0x07;
+		} else {
+			return EOF; // continuation bytes and leads of overlong or too large values
+		}
+		while(n--) {
+			int next=x.peek();
+			if (next==EOF || 0x80!=(next&0xc0))
+				return EOF; // mid-character EOF or a byte that isn't a continuation
+			x.get();
 			out=(out<<6)|(next&0x3f);
-			mask = (mask<<1)&0xff;
 		}
+		// overlong forms, surrogates and values above U+10FFFF
+		if (out<min || (out>=0xd800 && out<0xe000) || out>0x10ffff)
+			return EOF;
 		return out;
 	}
 
-	// the public JSON parsing function
-	// X is the type of the RPOCO conforming target data type that will receive the root JSON data object.
-	// utf16 to utf8 translates utf16 surrogate pairs to utf8 codepoints
-	template<typename X> bool parse(std::istream &in,X &x,bool allow_c_comments = false,bool utf16_to_utf8 = true) {
-		// an internal class with the actual logic acting as a rpoco visitor
-		struct json_parser : public rpoco::visitor {
-			// validity indicator, used for early exiting after errors
-			bool ok = true;
-			// the input
-			std::istream *ins;
-			// temporary string object used during various phases of the parsing
-			std::string tmp;
-			// allow C/C++ style comments within JSON literals
-			bool allow_c_comments;
-			// decode utf16 surrogates
-			bool utf16_to_utf8;
+	// escapes for ASCII characters in JSON strings, 0 for characters written
+	// as-is, 'u' for characters written as \u00XX and otherwise the character
+	// to write after a backslash.
+	struct escape_table {
+		char esc[128];
+		constexpr escape_table() : esc() {
+			for (int i=0;i<32;i++)
+				esc[i]='u';
+			esc[(int)'\b']='b';
+			esc[(int)'\f']='f';
+			esc[(int)'\n']='n';
+			esc[(int)'\r']='r';
+			esc[(int)'\t']='t';
+			esc[(int)'"']='"';
+			esc[(int)'\\']='\\';
+			esc[127]='u';
+		}
+	};
+	inline constexpr escape_table json_escapes;
 
-			// constructor to take the options and input for the parser.
-			json_parser(std::istream &ins,bool allow_c_comments = false,bool utf16_to_utf8 = true) {
-				this->ins=&ins;
-				this->allow_c_comments = allow_c_comments;
-				this->utf16_to_utf8 = utf16_to_utf8;
-			}
-			// skip non-spaces (and comments if that is enabled)
-			void skip() {
-				while (ok) {
-					if (std::isspace(ins->peek())) {
-						ins->get();
+	// holds the data that string views parsed from a document references
+	// beyond the parsed input itself.
+	class parse_result {
+		friend struct json_parser;
+		template<typename X> friend bool parse(std::istream &in,X &x,parse_result &result,const parse_options &opts);
+		// the input text when parsing from streams
+		std::string m_input;
+		// storage of decoded strings
+		rpoco::arena m_arena;
+	public:
+		// release all the data, views from previous parses are invalid after this.
+		void reset() {
+			m_input.clear();
+			m_arena.reset();
+		}
+		rpoco::arena& arena() {
+			return m_arena;
+		}
+	};
+
+	// the parser class with the actual logic acting as a rpoco visitor,
+	// the class is final so that visitation templates instantiated
+	// directly on it are statically dispatched.
+	struct json_parser final : public rpoco::visitor {
+		// validity indicator, used for early exiting after errors
+		bool ok = true;
+		// the input range with a stream like interface, the parser works directly
+		// on a contiguous buffer to avoid per character stream calls.
+		struct cursor {
+			const char *cur;
+			const char *end;
+			int peek() {
+				return cur!=end ? (uint8_t)*cur : EOF;
+			}
+			int get() {
+				return cur!=end ? (uint8_t)*cur++ : EOF;
+			}
+		} in;
+		// temporary string object used during various phases of the parsing
+		std::string tmp;
+		// allow C/C++ style comments within JSON literals
+		bool allow_c_comments;
+		// decode utf16 surrogates
+		bool utf16_to_utf8;
+		// can string views reference the input
+		bool reference_input;
+		// storage for strings views that cannot reference the input
+		parse_result *result;
+		// resource for allocations of consumed data (0 uses the default allocators)
+		std::pmr::memory_resource *resource=0;
+
+		// constructor to take the options and input for the parser.
+		json_parser(std::string_view input,bool allow_c_comments = false,bool utf16_to_utf8 = true,parse_result *result = 0,bool reference_input = true) {
+			in.cur=input.data();
+			in.end=input.data()+input.size();
+			this->result = result;
+			this->reference_input = reference_input;
+			this->allow_c_comments = allow_c_comments;
+			this->utf16_to_utf8 = utf16_to_utf8;
+		}
+		// parse the whole input into x
+		template<typename X> bool run(X &x) {
+			rpoco::visit<X,json_parser>(*this,x);
+			skip();
+			return ok && in.cur==in.end;
+		}
+		// skip non-spaces (and comments if that is enabled)
+		void skip() {
+			while (ok) {
+				in.cur=rpoco::skip_space(in.cur,in.end);
+				if (allow_c_comments && in.peek() == '/') {
+					in.get(); // eat '/'
+					switch (in.peek()) { // what kind of comment do we have
+					case '/' :
+						// single line comment, eat until carriage return,linefeed or form feed
+						while (true) {
+							int c = in.peek();
+							if (c == 13 || c == 10 || c == 12 || c==EOF) {
+								break;
+							} else {
+								in.get();
+								continue;
+							}
+						}
 						continue;
-					}
-					if (allow_c_comments && ins->peek() == '/') {
-						ins->get(); // eat '/'
-						switch (ins->peek()) { // what kind of comment do we have
-						case '/' :
-							// single line comment, eat until carriage return,linefeed or form feed
-							while (true) {
-								int c = ins->peek();
-								if (c == 13 || c == 10 || c == 12 || c==EOF) {
+					case '*' :
+						// multiline comment
+						{
+							in.get(); // eat '*'
+							int last = 0;
+							while (ok) {
+								int c = in.get();
+								if (c == EOF) {
+									// EOF inside comment leads to a syntax error.
+									ok = false;
+									break;
+								} else if (last == '*'&&c == '/') {
+									// end of multiline comment found.
 									break;
 								} else {
-									ins->get();
-									continue;
+									last = c;
 								}
 							}
-							continue;
-						case '*' :
-							// multiline comment
-							{
-								ins->get(); // eat '*'
-								int last = 0;
-								while (ok) {
-									int c = ins->get();
-									if (c == EOF) {
-										// EOF inside comment leads to a syntax error.
-										ok = false;
-										break;
-									} else if (last == '*'&&c == '/') {
-										// end of multiline comment found.
-										break;
-									} else {
-										last = c;
-									}
-								}
-								if (ok)
-									continue;
-								break;
-							}
-						default:
-							// syntax error in JSON
-							ok = false;
+							if (ok)
+								continue;
 							break;
 						}
+					default:
+						// syntax error in JSON
+						ok = false;
+						break;
 					}
-					// not a comment
-					break;
-				}
-			}
-			// production functions are invalid to be called by the visitor during parsing.
-			virtual void produce_start(rpoco::visit_type vt) {
-				abort(); // should not be called
-			}
-			// production functions are invalid to be called by the visitor during parsing.
-			virtual void produce_end(rpoco::visit_type vt) {
-				abort(); // should not be called
-			}
-			// the peek function hints at what kind of objects can be consumed.
-			virtual rpoco::visit_type peek() {
-				skip(); // skip any spaces and comments so we can identify the token based on the first character
-				// first check digits
-				if (std::isdigit(ins->peek()))
-					return rpoco::vt_number;
-				switch(ins->peek()) {
-				case '{' : // object start
-					return rpoco::vt_object;
-				case '[' : // array start
-					return rpoco::vt_array;
-				case '\"' : // string start
-					return rpoco::vt_string;
-				case 't' : // true start
-				case 'f' : // false start
-					return rpoco::vt_bool;
-				case 'n' : // null start
-					return rpoco::vt_null;
-				case '-' : // negative number start
-					return rpoco::vt_number;
-				default: // invalid object start, stop parsing.
-					ok=false;
-					return rpoco::vt_error;
 				}
+				// not a comment
+				break;
 			}
-			// a match function used to skip the remainder of known constants (null/true/false)
-			void match(const char *s) {
-				for (int i=0;s[i];i++)
-					ok&= (ins->get()==s[i]);
+		}
+		// production functions are invalid to be called by the visitor during parsing.
+		virtual void produce_start(rpoco::visit_type vt) {
+			abort(); // should not be called
+		}
+		// production functions are invalid to be called by the visitor during parsing.
+		virtual void produce_end(rpoco::visit_type vt) {
+			abort(); // should not be called
+		}
+		// the peek function hints at what kind of objects can be consumed.
+		virtual rpoco::visit_type peek() {
+			skip(); // skip any spaces and comments so we can identify the token based on the first character
+			// first check digits
+			if (std::isdigit(in.peek()))
+				return rpoco::vt_number;
+			switch(in.peek()) {
+			case '{' : // object start
+				return rpoco::vt_object;
+			case '[' : // array start
+				return rpoco::vt_array;
+			case '\"' : // string start
+				return rpoco::vt_string;
+			case 't' : // true start
+			case 'f' : // false start
+				return rpoco::vt_bool;
+			case 'n' : // null start
+				return rpoco::vt_null;
+			case '-' : // negative number start
+				return rpoco::vt_number;
+			default: // invalid object start, stop parsing.
+				ok=false;
+				return rpoco::vt_error;
 			}
-			// null parsing
-			virtual void visit_null() {
+		}
+		// a match function used to skip the remainder of known constants (null/true/false)
+		void match(const char *s) {
+			for (int i=0;s[i];i++)
+				ok&= (in.get()==s[i]);
+		}
+		// null parsing
+		virtual void visit_null() {
+			skip();
+			match("null");
+		}
+		// object and array parsing function ("consumption")
+		// the visit type is checked and then the 
+		virtual bool consume(rpoco::visit_type vt,rpoco::consume_fn g) {
+			return consume<rpoco::consume_fn&>(vt,g);
+		}
+		// the consumption loop, templated on the callback so that visitation
+		// templates instantiated on the parser can inline the element handling.
+		template<typename G> bool consume(rpoco::visit_type vt,G &&g) {
+			skip();
+			if (vt==rpoco::vt_object) {
+				// JSON object
+				ok&=in.get()=='{';
+				if (!ok) return true;
 				skip();
-				match("null");
+				if (in.peek() != '}')
+					while(ok) {
+						// first validate and get the property name string
+						skip();
+						ok&=in.peek()=='"';
+						if (!ok) break; // stop if not a string property
+						// now reset the tmp string
+						tmp.clear();
+						// read in the property name
+						read_string(tmp);
+						// ensure that we have a correct separator :
+						skip();
+						ok&=in.get()==':';
+						if (!ok) break; // stop if syntax error
+						skip();
+						// invoke the consumer function with the key to parse the rest
+						g(rpoco::name_ref(tmp));
+						tmp.clear();
+						skip();
+						if (in.peek()=='}')
+							break; // end of object
+						ok&=in.get()==',';
+						skip();
+					}
+				if (ok)
+					in.get(); // read '}'
+			} else if (vt==rpoco::vt_array) {
+				// JSON array
+				ok&=in.get()=='[';
+				if (!ok) return true;
+				rpoco::name_ref noname{std::string_view()};
+				if (in.peek()!=']')
+					while(ok) {
+						skip();
+						// just let the consumer read in the members
+						g(noname);
+						skip();
+						// and detect the trailing ']' or check the separator comma
+						if (in.peek()==']')
+							break;
+						ok&=in.get()==',';
+						skip();
+					}
+				if (ok)
+					in.get(); // get end ']'
+			} else abort(); // consume can only be called for objects and arrays
+			return true;
+		}
+		// boolean parsing
+		virtual void visit(bool &bv) {
+			skip();
+			if (in.peek()=='t') {
+				bv=true;
+				match("true");
+			} else {
+				bv=false;
+				match("false");
 			}
-			// object and array parsing function ("consumption")
-			// the visit type is checked and then the 
-			virtual bool consume(rpoco::visit_type vt,std::function<void (std::string&)> g) {
-				skip();
-				if (vt==rpoco::vt_object) {
-					// JSON object
-					ok&=ins->get()=='{';
-					if (!ok) return true;
-					skip();
-					if (ins->peek() != '}')
-						while(ok) {
-							// first validate and get the property name string
-							skip();
-							ok&=ins->peek()=='"';
-							if (!ok) break; // stop if not a string property
-							// now reset the tmp string
-							tmp.clear();
-							// read in the property name
-							visit(tmp);
-							// ensure that we have a correct separator :
-							skip();
-							ok&=ins->get()==':';
-							if (!ok) break; // stop if syntax error
-							skip();
-							// invoke the consumer function with the key to parse the rest
-							g(tmp);
-							tmp.clear();
-							skip();
-							if (ins->peek()=='}')
-								break; // end of object
-							ok&=ins->get()==',';
-							skip();
-						}
-					if (ok)
-						ins->get(); // read '}'
-				} else if (vt==rpoco::vt_array) {
-					// JSON array
-					ok&=ins->get()=='[';
-					if (!ok) return true;
-					tmp.clear();
-					if (ins->peek()!=']')
-						while(ok) {
-							skip();
-							// just let the consumer read in the members
-							g(tmp);
-							skip();
-							// and detect the trailing ']' or check the separator comma
-							if (ins->peek()==']')
-								break;
-							ok&=ins->get()==',';
-							skip();
-						}
-					if (ok)
-						ins->get(); // get end ']'
-				} else abort(); // consume can only be called for objects and arrays
-				return true;
+		}
+		// double number visitor, the number is parsed directly from the
+		// input without any locale dependencies (see rpoconum.hpp)
+		virtual void visit(double &dv) {
+			skip();
+			const char *end=rpoco::parse_double(in.cur,in.end,dv);
+			if (!end) {
+				ok=false;
+				return;
 			}
-			// boolean parsing
-			virtual void visit(bool &bv) {
-				skip();
-				if (ins->peek()=='t') {
-					bv=true;
-					match("true");
-				} else {
-					bv=false;
-					match("false");
-				}
+			in.cur=end;
+		}
+		// integer visitor, has a fast path for obvious integers and also
+		// a checking path that converts the number to a double and then
+		// checks that the result is still an integer (or fails the parsing)
+		virtual void visit(int &iv) {
+			skip();
+			rpoco::number_parts np;
+			const char *end=rpoco::scan_number(in.cur,in.end,np);
+			if (!end) {
+				ok=false;
+				return;
 			}
-			// a dual purpose function to parse JSON numbers
-			// and convert them to a double of the current locale since the
-			// standard built in double parsing functions are locale dependant
-			void consume_frac_and_exp() {
-				// if we have a decimal point consume it.
-				if (ins->peek()=='.') {
-					// eat the dot
-					ins->get();
-					// but append the locale decimal point
-					tmp.append( localeconv()->decimal_point );
-					while(std::isdigit(ins->peek()))
-						tmp.push_back(ins->get());
+			if (np.integer && !np.truncated && np.exponent==0 && np.mantissa<=(uint64_t)INT_MAX+1) {
+				// simple integer
+				int64_t v=np.negative ? -(int64_t)np.mantissa : (int64_t)np.mantissa;
+				ok&=v>=INT_MIN && v<=INT_MAX;
+				iv=(int)v;
+			} else {
+				// not encoded as a just a simple integer, verify that the number was a valid integer.
+				double dv=rpoco::number_to_double(np,in.cur,end);
+				ok&=dv>=INT_MIN && dv<=INT_MAX;
+				if (ok) {
+					iv=(int)dv;
+					ok=((double)iv==dv);
 				}
-				// do we have an exponent?
-				if (ins->peek()=='e' || ins->peek()=='E') {
-					tmp.push_back(ins->get());
-					if (ins->peek()=='+' || ins->peek()=='-') {
-						tmp.push_back(ins->get());
-					}
-					if(!std::isdigit(ins->peek()))
-						ok=false;
-					while(std::isdigit(ins->peek()))
-						tmp.push_back(ins->get());
+			}
+			in.cur=end;
+		}
+		// reads a single UTF16 character inside a string, used by
+		// the string parsing to convert the result to a
+		// UTF8 representation without codepoints.
+		int readSimpleCharacter() {
+			int c=read_utf8(in);
+			if (c=='\\') {
+				switch(c=in.get()) {
+				case '\"' : case '\\' : case '/' :
+					break; // use the character found directly.
+				case 'b' :
+					c='\b';
+					break;
+				case 'f' :
+					c='\f';
+					break;
+				case 'n' :
+					c='\n';
+					break;
+				case 'r' :
+					c='\r';
+					break;
+				case 't' :
+					c='\t';
+					break;
+				case 'u' : {
+						c=0;
+						for (int i=0;i<4;i++) {
+							int tmp=in.get();
+							c=c<<4;
+							if ( '0'<=tmp && tmp<='9')
+								c|=tmp-'0';
+							else if ( 'A'<=tmp && tmp<='F')
+								c|=tmp-'A'+10;
+							else if ( 'a'<=tmp && tmp<='f')
+								c|=tmp-'a'+10;
+							else {
+								ok=false;
+								return EOF;
+							}
+						}
+					} break;
+				default:
+					ok=false;
+					return EOF;
 				}
 			}
-			// double number visitor
-			virtual void visit(double &dv) {
-				skip();
-				tmp.clear();
-				// consume negative sign
-				if (ins->peek()=='-') {
-					tmp.push_back(ins->get());
+			return c;
+		}
+		// Parse strings to UTF8, converts UTF16 surrogate pairs
+		// to full codepoints if the option is enabled. The previous
+		// contents of the string are replaced.
+		virtual void visit(std::string &str) {
+			str.clear();
+			read_string(str);
+		}
+		// the string reader, runs without escapes are located with the
+		// vectorized scanner and copied directly after UTF8 validation.
+		void read_string(std::string &str) {
+			skip();
+			ok&=in.get()=='"';
+			if (!ok) return;
+			while(ok) {
+				const char *run=in.cur;
+				bool non_ascii=false;
+				in.cur=rpoco::scan_string(in.cur,in.end,non_ascii);
+				if (non_ascii && !rpoco::validate_utf8(run,in.cur)) {
+					ok=false;
+					return;
 				}
-				// consume either a solitary 0 or a sequence of digits
-				if (ins->peek()=='0') {
-					tmp.push_back(ins->get());
-				} else if (std::isdigit(ins->peek())) {
-					while(std::isdigit(ins->peek()))
-						tmp.push_back(ins->get());
-				} else {
+				str.append(run,in.cur-run);
+				int c=in.peek();
+				if (c=='"')
+					break;
+				if (c==EOF || c<32) {
+					// EOF or control code encountered
 					ok=false;
 					return;
 				}
-				consume_frac_and_exp();
-				if (ok)
-					dv=std::stod(tmp);
-				tmp.clear();
+				// an escape sequence
+				c=readSimpleCharacter();
+				if (c==EOF) {
+					ok=false;
+					break;
+				}
+				if(utf16_to_utf8 && c>=0xd800 && c<0xdc00) {
+					// surrogate pair encountered and conversion enabled.
+					int c2=readSimpleCharacter();
+					if (!(c2>=0xdc00 && c2<0xe000)) {
+						// invalid secondary surrogate pair character
+						ok=false;
+						return;
+					}
+					c=( ((c&0x3ff)<<10)|(c2&0x3ff) )+0x10000;
+				}
+				dump_utf8(str,c);
 			}
-			// integer visitor, has a fast path for obvious integers and also
-			// a checking path that parses the number as a double and then
-			// checks that the result is still an integer (or fails the parsing)
-			virtual void visit(int &iv) {
-				skip();
-				int sign=1;
-				int acc=0;
-				if (ins->peek()=='-') {
-					ins->get();
-					sign=-1;
+			// eat "
+			in.get();
+		}
+		// string views references the input when possible, strings with
+		// escapes are decoded and stored in the parse result.
+		virtual void visit(std::string_view &sv) {
+			skip();
+			const char *start=in.cur;
+			ok&=in.get()=='"';
+			if (!ok) return;
+			const char *s=in.cur;
+			// look for the end of the string
+			bool non_ascii=false;
+			in.cur=rpoco::scan_string(in.cur,in.end,non_ascii);
+			if (reference_input && in.cur!=in.end && *in.cur=='"') {
+				// plain string, reference it
+				ok&=!non_ascii || rpoco::validate_utf8(s,in.cur);
+				sv=std::string_view(s,in.cur-s);
+				in.cur++;
+				return;
+			}
+			if (!result && !resource) {
+				// no place to put the decoded string
+				ok=false;
+				return;
+			}
+			// decode it from the start
+			in.cur=start;
+			tmp.clear();
+			read_string(tmp);
+			if (ok && result) {
+				sv=result->m_arena.store(tmp);
+			} else if (ok) {
+				char *p=(char*)resource->allocate(tmp.size(),1);
+				memcpy(p,tmp.data(),tmp.size());
+				sv=std::string_view(p,tmp.size());
+			}
+			tmp.clear();
+		}
+		virtual std::pmr::memory_resource* memory_resource() {
+			return resource;
+		}
+		// fixed size string
+		virtual void visit(char *str,size_t sz) {
+			std::string tmp;
+			visit(tmp);
+			if (tmp.size()>=sz) {
+				ok=false;
+				str[0] = 0;
+			} else {
+				memcpy(str,tmp.data(),tmp.size());
+				str[tmp.size()] = 0;
+			}
+		}
+	};
+	// Output sinks receive the writer output in blocks of the requested block size
+	// (only the final block is shorter).
+	struct json_sink {
+		virtual ~json_sink() {}
+		// write a block of output, returns false if the output failed
+		virtual bool write(const char *data,size_t sz)=0;
+	};
+	// sink writing to a standard stream
+	struct ostream_sink final : json_sink {
+		std::ostream &out;
+		ostream_sink(std::ostream &out) : out(out) {}
+		virtual bool write(const char *data,size_t sz) {
+			out.write(data,(std::streamsize)sz);
+			return !out.fail();
+		}
+	};
+	// sink writing to a file descriptor (retrying on partial writes)
+	struct fd_sink final : json_sink {
+		int fd;
+		fd_sink(int fd) : fd(fd) {}
+		virtual bool write(const char *data,size_t sz) {
+			while(sz) {
+#ifdef _WIN32
+				int wr=::_write(fd,data,(unsigned)(sz>0x40000000 ? 0x40000000 : sz));
+#else
+				ssize_t wr=::write(fd,data,sz);
+				if (wr<0 && errno==EINTR)
+					continue;
+#endif
+				if (wr<=0)
+					return false;
+				data+=wr;
+				sz-=(size_t)wr;
+			}
+			return true;
+		}
+	};
+	// sink filling a fixed caller buffer, the size counts all output so that
+	// the caller can find out how big the buffer needs to be.
+	struct fixed_sink final : json_sink {
+		char *buf;
+		size_t capacity;
+		size_t size;
+		fixed_sink(char *buf,size_t capacity) : buf(buf),capacity(capacity),size(0) {}
+		virtual bool write(const char *data,size_t sz) {
+			if (size<capacity)
+				memcpy(buf+size,data,sz<capacity-size ? sz : capacity-size);
+			size+=sz;
+			return true;
+		}
+	};
+	// sink appending to a caller owned string, clearing the string
+	// between uses keeps the allocated memory for the next document.
+	struct string_sink final : json_sink {
+		std::string &out;
+		string_sink(std::string &out) : out(out) {}
+		virtual bool write(const char *data,size_t sz) {
+			out.append(data,sz);
+			return true;
+		}
+	};
+#ifdef _WIN32
+	// same layout as the POSIX iovec
+	struct iovec {
+		void *iov_base;
+		size_t iov_len;
+	};
+#else
+	using ::iovec;
+#endif
+	// the output of the scatter-gather writer, the JSON text is the concatenation
+	// of the segments that either reference the generated text held by this
+	// object or the original string data of the written object.
+	class json_iovec {
+		friend struct json_writer;
+		template<typename X> friend void to_json(X &x,json_iovec &out,const write_options &opts);
+		// segments are recorded as offsets while the buffer can still move
+		struct piece {
+			const char *ref; // referenced data or null for generated text
+			size_t offset;
+			size_t size;
+		};
+		std::string m_buf;
+		std::vector<piece> m_pieces;
+		std::vector<iovec> m_iov;
+		size_t m_size;
+		// build the segment list once the generated text is complete
+		void build() {
+			m_iov.clear();
+			m_size=0;
+			for (const piece &p:m_pieces) {
+				const char *data=p.ref ? p.ref : m_buf.data()+p.offset;
+				m_iov.push_back(iovec{(void*)data,p.size});
+				m_size+=p.size;
+			}
+		}
+	public:
+		// strings of at least this size are referenced instead of copied
+		size_t min_reference;
+		json_iovec(size_t min_reference=4096) : m_size(0),min_reference(min_reference) {}
+		const iovec* data() const {
+			return m_iov.data();
+		}
+		size_t count() const {
+			return m_iov.size();
+		}
+		// total size of the JSON text
+		size_t size() const {
+			return m_size;
+		}
+		// the JSON text as a single string
+		std::string str() const {
+			std::string res;
+			res.reserve(m_size);
+			for (const iovec &v:m_iov)
+				res.append((const char*)v.iov_base,v.iov_len);
+			return res;
+		}
+		// write all segments to a file descriptor or socket, returns false on failure
+		bool write(int fd) const {
+			std::vector<iovec> rest(m_iov);
+			iovec *cur=rest.data();
+			size_t left=rest.size();
+			while(left) {
+#ifdef _WIN32
+				int wr=::_write(fd,cur->iov_base,(unsigned)(cur->iov_len>0x40000000 ? 0x40000000 : cur->iov_len));
+#else
+#ifdef IOV_MAX
+				int batch=(int)(left<IOV_MAX ? left : IOV_MAX);
+#else
+				int batch=(int)(left<1024 ? left : 1024);
+#endif
+				ssize_t wr=::writev(fd,cur,batch);
+				if (wr<0 && errno==EINTR)
+					continue;
+#endif
+				if (wr<0 || (wr==0 && cur->iov_len))
+					return false;
+				// skip the written segments and adjust a partially written one
+				size_t done=(size_t)wr;
+				while(left && done>=cur->iov_len) {
+					done-=cur->iov_len;
+					cur++;
+					left--;
 				}
-				while(std::isdigit(ins->peek())) {
-					acc=acc*10 + ( ins->get()-'0' );
+				if (left) {
+					cur->iov_base=(char*)cur->iov_base+done;
+					cur->iov_len-=done;
 				}
-				iv=sign*acc;
-				// now a fallback in case we got something more complex than a simple integer.
-				int c=ins->peek();
-				if (c=='.' || c=='e' || c=='E') {
-					// not encoded as a just a simple integer, do a complex fallback path.
-					// first dump the integer prefix
-					tmp=std::to_string(acc);
-					// then consume the rest of the number info
-					consume_frac_and_exp();
-					if (ok) {
-						double dv=std::stod(tmp);
-						iv=(int)dv;
-						// verify that the number was a valid integer.
-						ok=((double)iv==dv);
-					}
-					tmp.clear();
+			}
+			return true;
+		}
+	};
+	// precomputed ,"name": key prefixes for the members of a RPOCO type so the
+	// writer can emit the separator and key of a member with a single copy.
+	// member names are C++ identifiers so they never need escaping.
+	template<typename T> struct json_keys {
+		typedef rpoco::type_info_table_of<T> table;
+		static constexpr size_t count=sizeof(table::members)/sizeof(rpoco::member);
+		static constexpr size_t length=[]() {
+			size_t len=0;
+			for (size_t i=0;i<count;i++)
+				len+=table::members[i].name().size()+4;
+			return len;
+		}();
+		struct key_data {
+			char text[length+1];
+			// start of each prefix, the key without separator starts one later
+			uint32_t start[count+1];
+		};
+		static constexpr key_data keys=[]() {
+			key_data kd={};
+			size_t pos=0;
+			for (size_t i=0;i<count;i++) {
+				std::string_view name=table::members[i].name();
+				kd.start[i]=(uint32_t)pos;
+				kd.text[pos++]=',';
+				kd.text[pos++]='"';
+				for (char c:name)
+					kd.text[pos++]=c;
+				kd.text[pos++]='"';
+				kd.text[pos++]=':';
+			}
+			kd.start[count]=(uint32_t)pos;
+			return kd;
+		}();
+	};
+	// the learned JSON size of a root type, the writer reserves the output
+	// from it so that large documents are not built through repeated reallocation.
+	// the size moves a quarter of the way towards each written size and at most
+	// doubles per document, so a single huge document only has a small and
+	// passing effect on the reservations made after it.
+	template<typename X> struct json_size_hint {
+		static inline std::atomic<size_t> size{0};
+		static size_t get() {
+			size_t sz=size.load(std::memory_order_relaxed);
+			return sz+sz/4;
+		}
+		static void update(size_t sz) {
+			size_t prev=size.load(std::memory_order_relaxed);
+			size_t next;
+			if (sz>=prev) {
+				size_t step=(sz-prev)/4+1;
+				size_t limit=prev>1024 ? prev : 1024;
+				next=prev+(step<limit ? step : limit);
+			} else {
+				next=prev-(prev-sz)/4;
+			}
+			size.store(next,std::memory_order_relaxed);
+		}
+	};
+	// a pool of threads that the writer runs parallel work on, the calling
+	// thread takes part in the work so a pool without threads runs everything
+	// on the caller. One job runs at a time, threads are started as jobs
+	// ask for them.
+	class worker_pool {
+		// a job lives on the stack of run(), workers only touch it between
+		// joining and leaving it and run() returns after all have left.
+		struct job {
+			void (*fn)(void *ctx,size_t idx);
+			void *ctx;
+			size_t count;
+			std::atomic<size_t> next;
+			size_t finished; // guarded by the pool mutex
+			unsigned workers; // workers that joined the job, guarded by the pool mutex
+			unsigned active; // workers still inside the job, guarded by the pool mutex
+			unsigned max_workers;
+		};
+		std::mutex m_mutex;
+		std::mutex m_job_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		std::vector<std::thread> m_threads;
+		// the current job, null between jobs
+		job *m_job;
+		uint64_t m_generation;
+		bool m_quit;
+		// take indexes of the job until there are none left
+		void work(job &j) {
+			size_t idx,done=0;
+			while((idx=j.next.fetch_add(1))<j.count) {
+				j.fn(j.ctx,idx);
+				done++;
+			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			j.finished+=done;
+		}
+		void worker() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			uint64_t seen=m_generation;
+			for (;;) {
+				m_wake.wait(lock,[&] { return m_quit || m_generation!=seen; });
+				if (m_quit)
+					return;
+				seen=m_generation;
+				// the job may already be done (or full) when this worker wakes up
+				job *j=m_job;
+				if (!j || j->workers>=j->max_workers)
+					continue;
+				j->workers++;
+				j->active++;
+				lock.unlock();
+				work(*j);
+				lock.lock();
+				j->active--;
+				m_done.notify_all();
+			}
+		}
+	public:
+		worker_pool() : m_job(0),m_generation(0),m_quit(false) {}
+		~worker_pool() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_quit=true;
+			}
+			m_wake.notify_all();
+			for (std::thread &t:m_threads)
+				t.join();
+		}
+		// run fn(idx) for all indexes below count on up to threads threads
+		// (including the caller) and wait for all to finish
+		template<typename F> void run(size_t count,unsigned threads,F &&fn) {
+			typedef typename std::remove_reference<F>::type FT;
+			std::lock_guard<std::mutex> guard(m_job_mutex);
+			unsigned workers=threads>1 ? threads-1 : 0;
+			while(m_threads.size()<workers)
+				m_threads.emplace_back([this] { worker(); });
+			job j;
+			j.fn=[](void *ctx,size_t idx) { (*(FT*)ctx)(idx); };
+			j.ctx=(void*)&fn;
+			j.count=count;
+			j.next=0;
+			j.finished=0;
+			j.workers=0;
+			j.active=0;
+			j.max_workers=workers;
+			if (workers) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_job=&j;
+				m_generation++;
+			}
+			m_wake.notify_all();
+			work(j);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock,[&] { return j.finished==count && j.active==0; });
+			// workers waking up later find no job
+			m_job=0;
+		}
+		// the shared pool used by the writer
+		static worker_pool& shared() {
+			static worker_pool pool;
+			return pool;
+		}
+	};
+	// the json_writer extends the rpoco::visitor struct to receive
+	// data as the generic visitation code visits the structure.
+	// the class is final so that visitation templates instantiated
+	// directly on it are statically dispatched.
+	struct json_writer final : public rpoco::visitor {
+		// the output string (with a sink only the data not yet flushed)
+		std::string out;
+		// optional sink to flush blocks of output to
+		json_sink *sink;
+		size_t block_size;
+		// the options the writer was created with
+		write_options opts;
+		// set when the sink has failed
+		bool failed;
+		// scatter-gather output that large clean strings are referenced from
+		json_iovec *iov;
+		size_t iov_start;
+		// state stack to keep track of terminators at each level.
+		enum wrstate {
+			def   =0x1, // default
+			objid =0x2, // inside object expecting a propname
+			objval=0x3, // inside object expecting a value
+			objnxt=0x4, // inside object either expecting term or a new propname
+			ary   =0x5, // inside array
+			arynxt=0x6, // inside array either expecting term or a new value
+			end   =0x1000 // termination
+		};
+		std::vector<wrstate> state;
+		// initialize state with a dummy constructor
+		json_writer(json_sink *sink=0,const write_options &opts=write_options()) : sink(sink),block_size(opts.block_size ? opts.block_size : 1),opts(opts),failed(false),iov(0),iov_start(0) {
+			state={def};
+			// with a sink the buffer never grows much beyond a block
+			if (sink)
+				out.reserve(block_size+block_size/4);
+		}
+		// check if a container of sz elements should be written in parallel
+		bool parallel(size_t sz) const {
+			return opts.threads>1 && sz>=opts.parallel_min && sz>=2;
+		}
+		// number of chunks a parallel container is split into, chunk c
+		// holds the elements from sz*c/chunks up to sz*(c+1)/chunks
+		size_t parallel_chunks(size_t sz) const {
+			size_t chunks=(size_t)opts.threads*4;
+			return chunks<sz ? chunks : sz;
+		}
+		// write the elements of a container in chunks on the worker pool, wr(writer,chunk,from,to)
+		// writes a range of elements and the chunks are then joined in order.
+		template<typename W> void produce_parallel(rpoco::visit_type vt,size_t sz,W &&wr) {
+			size_t chunks=parallel_chunks(sz);
+			std::vector<std::string> text(chunks);
+			// workers write serially with the same options
+			write_options wo=opts;
+			wo.threads=1;
+			worker_pool::shared().run(chunks,opts.threads,[&](size_t c) {
+				json_writer w(0,wo);
+				w.state.back()=vt==rpoco::vt_array ? ary : objid;
+				wr(w,c,sz*c/chunks,sz*(c+1)/chunks);
+				text[c].swap(w.out);
+			});
+			produce_start(vt);
+			for (std::string &t:text) {
+				if (state.back()==arynxt || state.back()==objnxt)
+					out.push_back(',');
+				out.append(t);
+				state.back()=vt==rpoco::vt_array ? arynxt : objnxt;
+				if (sink && out.size()>=block_size)
+					flush_blocks();
+			}
+			produce_end(vt);
+		}
+		// pass all complete blocks to the sink and keep the remainder
+		void flush_blocks() {
+			size_t sz=out.size()-out.size()%block_size;
+			for (size_t i=0;i<sz && !failed;i+=block_size)
+				failed=!sink->write(out.data()+i,block_size);
+			out.erase(0,sz);
+		}
+		// flush the remaining output to the sink, returns false if the sink failed
+		bool finish() {
+			if (sink) {
+				if (!failed && out.size())
+					failed=!sink->write(out.data(),out.size());
+				out.clear();
+			}
+			return !failed;
+		}
+		// pre-value function call to dump the appropriate separator
+		// characters when the value is a member of a object literal or array
+		void pre(bool str) {
+			if (state.back() == end) {
+				// cannot write objects if we're at an end-state
+				abort();
+			}
+			if (state.back()==objnxt) {
+				// with another property being added to an object,
+				// add a ',' and advance state
+				out.append(",");
+				state.back()=objid;
+			}
+			if (state.back()==objid && !str) {
+				// object property names must be strings
+				abort();
+			} else if (state.back()==arynxt) {
+				// append commas when expecting another value in
+				// an array
+				out.append(",");
+			}
+		}
+		// post-value, update state
+		void post() {
+			switch(state.back()) {
+			case ary :
+				state.back()=arynxt;
+				break;
+			case objid :
+				out.append(":");
+				state.back()=objval;
+				break;
+			case objval :
+				state.back()=objnxt;
+				break;
+			case def:
+				state.back()=end;
+				break;
+			}
+			if (sink && out.size()>=block_size)
+				flush_blocks();
+		}
+		// called when entering a object or array
+		// responsible for updating the state stack
+		virtual void produce_start(rpoco::visit_type vt) {
+			switch(vt) {
+			case rpoco::vt_object :
+				// update the previous level
+				pre(false);
+				// print and setup the object
+				out.append("{");
+				state.push_back(objid);
+				break;
+			case rpoco::vt_array :
+				// update the previous level
+				pre(false);
+				// print and setup the array
+				out.append("[");
+				state.push_back(ary);
+				break;
+			default:
+				abort();
+			}
+		}
+		// visitor interface to query production or consumption mode
+		virtual bool consume(rpoco::visit_type vt,rpoco::consume_fn g) {
+			// the generator does not consume anything, return false
+			return false;
+		}
+		// called to produce the object end
+		virtual void produce_end(rpoco::visit_type vt) {
+			switch(vt) {
+			case rpoco::vt_object :
+				// sanity check
+				if (state.back()!=objid && state.back()!=objnxt)
+					abort();
+				// exit object
+				state.pop_back();
+				out.append("}");
+				// call parent state to indicate end-of-value
+				post();
+				break;
+			case rpoco::vt_array :
+				// sanity check
+				if (state.back()!=ary && state.back()!=arynxt)
+					abort();
+				// exit array
+				state.pop_back();
+				out.append("]");
+				// call parent state to indicate end-of-value
+				post();
+				break;
+			default:
+				abort();
+			}
+		}
+		// boolean visitor
+		virtual void visit(bool& bv) {
+			// sanity check
+			if (state.back()==objid)
+				abort();
+			// inform parent of value start
+			pre(false);
+			// dump value
+			out.append(bv?"true":"false");
+			// inform parent of value end
+			post();
+		}
+		// double visitor
+		virtual void visit(double& dv) {
+			// sanity check
+			if (state.back()==objid)
+				abort();
+			// inform parent of value start
+			pre(false);
+			// dump the shortest round-trip double string (locale independent)
+			char buf[32];
+			out.append(buf,rpoco::format_double(buf,dv)-buf);
+			// inform parent of value end
+			post();
+		}
+		// integer visitor
+		virtual void visit(int& iv) {
+			// sanity check
+			if (state.back()==objid)
+				abort();
+			// inform parent of value start
+			pre(false);
+			// dump integer string
+			char buf[24];
+			out.append(buf,rpoco::format_int(buf,iv)-buf);
+			// inform parent of value end
+			post();
+		}
+		// get 1 hex character
+		char toHex(int c) {
+			c&=0xf;
+			if (c<10)
+				return c+'0';
+			else
+				return c-10+'A';
+		}
+		// dump JSON UTF16 codepoint
+		void dumpUniEscape( int c) {
+			out.append("\\u");
+			out.push_back( toHex(c>>12) );
+			out.push_back( toHex(c>>8) );
+			out.push_back( toHex(c>>4) );
+			out.push_back( toHex(c) );
+		}
+		// visit null terminated string, written directly from the buffer
+		virtual void visit(char *str,size_t sz) {
+			const char *term=(const char*)memchr(str,0,sz);
+			write_string(std::string_view(str,term ? term-str : sz));
+		}
+		// names not known at compile time (map keys) are written as strings
+		virtual void produce_name(std::string_view name) {
+			write_string(name);
+		}
+		// RPOCO objects are written as arrays of values when requested
+		template<typename T> bool produce_positional() {
+			return opts.positional || rpoco::positional_encoding<T>::value;
+		}
+		virtual bool produce_positional(const rpoco::type_info &ti) {
+			return opts.positional || ti.positional();
+		}
+		// write a RPOCO object as an array of its member values
+		template<typename F> void produce_row(F &f) {
+			produce_start(rpoco::vt_array);
+			rpoco::type_info_table_of<F>::produce_values(*this,f);
+			produce_end(rpoco::vt_array);
+		}
+		// start the columnar form of a vector of objects described by ti
+		// in columnar mode, the rows array comes next
+		virtual bool produce_columns(const rpoco::type_info &ti) {
+			if (!opts.columnar)
+				return false;
+			produce_start(rpoco::vt_object);
+			produce_name("columns");
+			produce_start(rpoco::vt_array);
+			for (int i=0;i<ti.size();i++)
+				write_string(ti[i].name());
+			produce_end(rpoco::vt_array);
+			produce_name("rows");
+			return true;
+		}
+		// write a vector of RPOCO objects in the columnar form
+		template<typename F,typename A> void produce_columnar(std::vector<F,A> &vec) {
+			produce_columns(rpoco::type_info_of<F>());
+			if (parallel(vec.size())) {
+				produce_parallel(rpoco::vt_array,vec.size(),[&vec](json_writer &w,size_t,size_t from,size_t to) {
+					for (size_t i=from;i<to;i++)
+						w.produce_row(vec[i]);
+				});
+			} else {
+				produce_start(rpoco::vt_array);
+				for (F &f:vec)
+					produce_row(f);
+				produce_end(rpoco::vt_array);
+			}
+			produce_end(rpoco::vt_object);
+		}
+		// members equal to their default are left out in omit-defaults mode
+		template<typename T,size_t I> bool omit_member(T &t) {
+			if (!opts.omit_defaults)
+				return false;
+			typedef typename rpoco::type_info_table_of<T>::template field_at<I> field;
+			return rpoco::default_compare<typename field::type>::equal(t.*field::pointer,rpoco::default_object<T>().*field::pointer);
+		}
+		virtual bool omit_member(const rpoco::type_info &ti,size_t idx,void *obj) {
+			return opts.omit_defaults && ti[(int)idx].is_default(obj);
+		}
+		// RPOCO member names are copied from the precomputed key prefixes
+		// and the state advanced as if the name had been written as a value.
+		template<typename T,size_t I> void produce_member() {
+			typedef json_keys<T> keys;
+			uint32_t start=keys::keys.start[I];
+			if (state.back()==objid)
+				start++; // first member, skip the separator
+			else if (state.back()!=objnxt)
+				abort();
+			out.append(keys::keys.text+start,keys::keys.start[I+1]-start);
+			state.back()=objval;
+		}
+		virtual void visit(std::string &str) {
+			write_string(str);
+		}
+		virtual void visit(std::string_view &sv) {
+			write_string(sv);
+		}
+		// write a decoded character that needed escaping
+		void write_char(int c) {
+			if (opts.raw_utf8 && c>=127 && c<=0x10ffff && !(c>=0xd800 && c<0xe000)) {
+				// re-encoding the decoded character keeps the output valid UTF8
+				dump_utf8(out,(uint32_t)c);
+			} else if (c>=0 && c<128) {
+				char esc=json_escapes.esc[c];
+				if (!esc) {
+					out.push_back((char)c);
+				} else if (esc=='u') {
+					dumpUniEscape(c);
+				} else {
+					out.push_back('\\');
+					out.push_back(esc);
 				}
+			} else if (c<0 || c>0x10ffff || (c>=0xd800 && c<0xe000)) {
+				// malformed UTF8 (EOF from read_utf8) and values that are not
+				// unicode scalars are written as the replacement character
+				if (opts.raw_utf8)
+					dump_utf8(out,0xfffd);
+				else
+					dumpUniEscape( 0xfffd );
+			} else if (c>0xffff) {
+				c-=0x10000;
+				dumpUniEscape( 0xd800 | ((c>>10)&0x3ff) );
+				dumpUniEscape( 0xdc00 | (c&0x3ff) );
+			} else {
+				dumpUniEscape( c );
 			}
-			// reads a single UTF16 character inside a string, used by
-			// the string parsing to convert the result to a
-			// UTF8 representation without codepoints.
-			int readSimpleCharacter() {
-				int c=read_utf8(*ins);
-				if (c=='\\') {
-					switch(c=ins->get()) {
-					case '\"' : case '\\' : case '/' :
-						break; // use the character found directly.
-					case 'b' :
-						c='\b';
-						break;
-					case 'f' :
-						c='\f';
-						break;
-					case 'n' :
-						c='\n';
-						break;
-					case 'r' :
-						c='\r';
-						break;
-					case 't' :
-						c='\t';
-						break;
-					case 'u' : {
-							c=0;
-							for (int i=0;i<4;i++) {
-								int tmp=ins->get();
-								c=c<<4;
-								if ( '0'<=tmp && tmp<='9')
-									c|=tmp-'0';
-								else if ( 'A'<=tmp && tmp<='F')
-									c|=tmp-'A'+10;
-								else if ( 'a'<=tmp && tmp<='f')
-									c|=tmp-'a'+10;
-								else {
-									ok=false;
-									return EOF;
-								}
-							}
-						} break;
-					default:
-						ok=false;
-						return EOF;
-					}
+		}
+		// check if a string can be written without any escaping
+		bool is_clean(std::string_view str) {
+			const char *e=str.data()+str.size();
+			if (!opts.raw_utf8)
+				return rpoco::scan_escape(str.data(),e)==e;
+			bool non_ascii=false;
+			return rpoco::scan_string(str.data(),e,non_ascii)==e && (!non_ascii || rpoco::validate_utf8(str.data(),e));
+		}
+		// reference data in the scatter-gather output, ending the current generated segment
+		void write_reference(std::string_view str) {
+			if (out.size()>iov_start)
+				iov->m_pieces.push_back(json_iovec::piece{0,iov_start,out.size()-iov_start});
+			iov->m_pieces.push_back(json_iovec::piece{str.data(),0,str.size()});
+			iov_start=out.size();
+		}
+		// end the scatter-gather output
+		void finish_iov() {
+			if (out.size()>iov_start)
+				iov->m_pieces.push_back(json_iovec::piece{0,iov_start,out.size()-iov_start});
+			iov_start=out.size();
+		}
+		void write_string(std::string_view str) {
+			struct src {
+				const char *cur;
+				const char *end;
+				int peek() {
+					return cur!=end ? (uint8_t)*cur : EOF;
 				}
-				return c;
+				int get() {
+					return cur!=end ? (uint8_t)*cur++ : EOF;
+				}
+			} in={str.data(),str.data()+str.size()};
+			pre(true);
+			out.push_back('"');
+			if (iov && str.size()>=iov->min_reference && is_clean(str)) {
+				write_reference(str);
+				in.cur=in.end;
 			}
-			// Parse strings to UTF8, converts UTF16 surrogate pairs
-			// to full codepoints if the option is enabled.
-			virtual void visit(std::string &str) {
-				skip();
-				ok&=ins->get()=='"';
-				if (!ok) return;
-				while(ok) {
-					int c=ins->peek();
-					if (c==EOF || c<32) {
-						// EOF or control code encountered
-						ok=false;
-						return;
-					}
-					if (c=='"')
-						break;
-					c=readSimpleCharacter();
-					if (c==EOF) {
-						ok=false;
-						break;
-					}
-					if(utf16_to_utf8 && c>=0xd800 && c<0xdc00) {
-						// surrogate pair encountered and conversion enabled.
-						int c2=readSimpleCharacter();
-						if (!(c2>=0xdc00 && c2<0xe000)) {
-							// invalid secondary surrogate pair character
-							ok=false;
-							return;
-						}
-						c=( ((c&0x3ff)<<10)|(c2&0x3ff) )+0x10000;
+			while(in.cur!=in.end) {
+				// copy runs of characters that need no escaping in bulk
+				const char *run=in.cur;
+				if (opts.raw_utf8) {
+					bool non_ascii=false;
+					in.cur=rpoco::scan_string(in.cur,in.end,non_ascii);
+					if (non_ascii && !rpoco::validate_utf8(run,in.cur)) {
+						// runs with broken UTF8 are written character by character
+						const char *stop=in.cur;
+						in.cur=run;
+						while(in.cur<stop)
+							write_char(read_utf8(in));
+						continue;
 					}
-					dump_utf8(str,c);
+				} else {
+					in.cur=rpoco::scan_escape(in.cur,in.end);
 				}
-				// eat "
-				ins->get();
-			}
-			// fixed size string
-			virtual void visit(char *str,size_t sz) {
-				std::string tmp;
-				visit(tmp);
-				if (tmp.size()>=sz) {
-					ok=false;
-					str[0] = 0;
+				out.append(run,in.cur-run);
+				// and then the exception
+				if (in.cur!=in.end)
+					write_char(read_utf8(in));
+			}
+			out.push_back('"');
+			post();
+		}
+		virtual rpoco::visit_type peek() {
+			return rpoco::vt_none;
+		}
+		virtual void visit_null() {
+			pre(false);
+			out.append("null");
+			post();
+		}
+	};
+};
+
+namespace rpoco {
+	// the parser reads vectors of RPOCO objects either as arrays or in the columnar form
+	template<typename F,typename A>
+	struct visit<std::vector<F,A>,rpocojson::json_parser> {
+		visit(rpocojson::json_parser &v,std::vector<F,A> &vp) {
+			reseat(vp,v.resource);
+			if constexpr (is_rpoco<F>::value) {
+				if (v.peek()==vt_object) {
+					columnar(v,vp);
+					return;
+				}
+			}
+			v.consume(vt_array,[&v,&vp](const name_ref&) {
+				vp.emplace_back();
+				rpoco::visit<F,rpocojson::json_parser>(v,vp.back());
+			});
+		}
+		// read the columns to map positions to members and then each row into a new object
+		static void columnar(rpocojson::json_parser &v,std::vector<F,A> &vp) {
+			typedef type_info_table_of<F> table;
+			const type_info &ti=table::ti;
+			std::vector<int> cols;
+			bool has_columns=false;
+			v.consume(vt_object,[&](const name_ref& n) {
+				if (n.name=="columns" && !has_columns) {
+					has_columns=true;
+					v.consume(vt_array,[&](const name_ref&) {
+						std::string name;
+						v.visit(name);
+						const member *m=ti.find(name_ref(name));
+						cols.push_back(m ? (int)(m-&ti[0]) : -1);
+					});
+				} else if (n.name=="rows" && has_columns) {
+					v.consume(vt_array,[&](const name_ref&) {
+						vp.emplace_back();
+						F &f=vp.back();
+						size_t col=0;
+						v.consume(vt_array,[&](const name_ref&) {
+							int idx=col<cols.size() ? cols[col] : -1;
+							col++;
+							if (idx<0) {
+								// unknown or extra columns are ignored
+								niltarget nt;
+								rpoco::visit<niltarget,rpocojson::json_parser>(v,nt);
+							} else {
+								table::template thunks<rpocojson::json_parser>[idx](v,(void*)&f);
+							}
+						});
+					});
 				} else {
-					memcpy(str,tmp.data(),sz);
-					str[sz] = 0;
+					// anything else is not a columnar array
+					v.ok=false;
 				}
+			});
+		}
+	};
+	// large vectors and maps are written in parallel when the writer is set up for it
+	template<typename F,typename A>
+	struct visit<std::vector<F,A>,rpocojson::json_writer> { visit(rpocojson::json_writer &v,std::vector<F,A> &vec) {
+		if constexpr (is_rpoco<F>::value) {
+			if (v.opts.columnar) {
+				v.produce_columnar(vec);
+				return;
 			}
-		};
+		}
+		if (v.parallel(vec.size())) {
+			v.produce_parallel(vt_array,vec.size(),[&vec](rpocojson::json_writer &w,size_t,size_t from,size_t to) {
+				for (size_t i=from;i<to;i++)
+					rpoco::visit<F,rpocojson::json_writer>(w,vec[i]);
+			});
+			return;
+		}
+		v.produce_start(vt_array);
+		for (F &f:vec)
+			rpoco::visit<F,rpocojson::json_writer>(v,f);
+		v.produce_end(vt_array);
+	}};
+	template<typename F>
+	struct visit<std::map<std::string,F>,rpocojson::json_writer> { visit(rpocojson::json_writer &v,std::map<std::string,F> &mp) {
+		if (v.parallel(mp.size())) {
+			// collect the chunk starts since map iterators cannot be indexed
+			size_t sz=mp.size(),chunks=v.parallel_chunks(sz),idx=0;
+			std::vector<typename std::map<std::string,F>::iterator> starts;
+			for (auto it=mp.begin();it!=mp.end();++it,++idx) {
+				if (idx==sz*starts.size()/chunks)
+					starts.push_back(it);
+			}
+			starts.push_back(mp.end());
+			v.produce_parallel(vt_object,sz,[&starts](rpocojson::json_writer &w,size_t c,size_t,size_t) {
+				for (auto it=starts[c];it!=starts[c+1];++it) {
+					w.produce_name(it->first);
+					rpoco::visit<F,rpocojson::json_writer>(w,it->second);
+				}
+			});
+			return;
+		}
+		v.produce_start(vt_object);
+		for (std::pair<const std::string,F> &p:mp) {
+			v.produce_name(p.first);
+			rpoco::visit<F,rpocojson::json_writer>(v,p.second);
+		}
+		v.produce_end(vt_object);
+	}};
+};
+
+namespace rpocojson {
+	// the public JSON parsing function
+	// X is the type of the RPOCO conforming target data type that will receive the root JSON data object.
+	// utf16 to utf8 translates utf16 surrogate pairs to utf8 codepoints
+	template<typename X> bool parse(std::string_view in,X &x,const parse_options &opts) {
 		// init parser object and then use it to visit the target
-		json_parser parser(in,allow_c_comments,utf16_to_utf8);
-		rpoco::visit<X>(parser,x);
-		parser.skip();
-		return parser.ok && EOF==in.peek();
+		json_parser parser(in,opts.allow_c_comments,opts.utf16_to_utf8);
+		return parser.run(x);
+	}
+	// streams are read into memory first since the whole
+	// stream has to be consumed for the parsing to succeed anyway.
+	// string views cannot reference the temporary buffer.
+	template<typename X> bool parse(std::istream &in,X &x,const parse_options &opts) {
+		std::string buf((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+		json_parser parser(buf,opts.allow_c_comments,opts.utf16_to_utf8,0,false);
+		return parser.run(x);
+	}
+	// parse with a result holding data referenced by string views
+	template<typename X> bool parse(std::string_view in,X &x,parse_result &result,const parse_options &opts) {
+		json_parser parser(in,opts.allow_c_comments,opts.utf16_to_utf8,&result);
+		return parser.run(x);
 	}
-	// small utility to wrap strings into streams if needed for parsing.
-	template<typename X> bool parse(std::string &str,X &x,bool allow_c_comments = false,bool utf16_to_utf8 = true) {
-		return parse(std::istringstream(str),x,allow_c_comments,utf16_to_utf8);
+	// the stream input is stored in the result so views can reference it.
+	template<typename X> bool parse(std::istream &in,X &x,parse_result &result,const parse_options &opts) {
+		result.m_input.assign(std::istreambuf_iterator<char>(in),std::istreambuf_iterator<char>());
+		return parse(std::string_view(result.m_input),x,result,opts);
+	}
+	// parse with allocations from a memory resource
+	template<typename X> bool parse(std::string_view in,X &x,std::pmr::memory_resource &mr,const parse_options &opts) {
+		json_parser parser(in,opts.allow_c_comments,opts.utf16_to_utf8);
+		parser.resource=&mr;
+		return parser.run(x);
+	}
+	// the stream input is temporary so string views are always decoded into the resource.
+	template<typename X> bool parse(std::istream &in,X &x,std::pmr::memory_resource &mr,const parse_options &opts) {
+		std::string buf((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+		json_parser parser(buf,opts.allow_c_comments,opts.utf16_to_utf8,0,false);
+		parser.resource=&mr;
+		return parser.run(x);
+	}
+	// the versions with the options as flags
+	template<typename X> bool parse(std::string_view in,X &x,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,parse_options{allow_c_comments,utf16_to_utf8});
+	}
+	template<typename X> bool parse(std::istream &in,X &x,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,parse_options{allow_c_comments,utf16_to_utf8});
+	}
+	template<typename X> bool parse(std::string_view in,X &x,parse_result &result,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,result,parse_options{allow_c_comments,utf16_to_utf8});
+	}
+	template<typename X> bool parse(std::istream &in,X &x,parse_result &result,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,result,parse_options{allow_c_comments,utf16_to_utf8});
+	}
+	template<typename X> bool parse(std::string_view in,X &x,std::pmr::memory_resource &mr,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,mr,parse_options{allow_c_comments,utf16_to_utf8});
+	}
+	template<typename X> bool parse(std::istream &in,X &x,std::pmr::memory_resource &mr,bool allow_c_comments,bool utf16_to_utf8) {
+		return parse(in,x,mr,parse_options{allow_c_comments,utf16_to_utf8});
 	}
 
 	// function to dump an arbitrary RPOCO oobject as a string containing a JSON object
-	template<typename X> std::string to_json(X &x) {
-		// the json_writer extends the rpoco::visitor struct to receive
-		// data as the generic visitation code visits the structure.
-		struct json_writer : public rpoco::visitor {
-			// the output string
-			std::string out;
-			// state stack to keep track of terminators at each level.
-			enum wrstate {
-				def   =0x1, // default
-				objid =0x2, // inside object expecting a propname
-				objval=0x3, // inside object expecting a value
-				objnxt=0x4, // inside object either expecting term or a new propname
-				ary   =0x5, // inside array
-				arynxt=0x6, // inside array either expecting term or a new value
-				end   =0x1000 // termination
-			};
-			std::vector<wrstate> state;
-			// initialize state with a dummy constructor
-			json_writer() {
-				state={def};
-			}
-			// pre-value function call to dump the appropriate separator
-			// characters when the value is a member of a object literal or array
-			void pre(bool str) {
-				if (state.back() == end) {
-					// cannot write objects if we're at an end-state
-					abort();
-				}
-				if (state.back()==objnxt) {
-					// with another property being added to an object,
-					// add a ',' and advance state
-					out.append(",");
-					state.back()=objid;
-				}
-				if (state.back()==objid && !str) {
-					// object property names must be strings
-					abort();
-				} else if (state.back()==arynxt) {
-					// append commas when expecting another value in
-					// an array
-					out.append(",");
+	template<typename X> std::string to_json(X &x,const write_options &opts) {
+		std::string out;
+		to_json(x,out,opts);
+		return out;
+	}
+	template<typename X> void to_json(X &x,std::string &out,const write_options &opts) {
+		json_writer writer(0,opts);
+		// write directly into the callers string
+		out.clear();
+		writer.out.swap(out);
+		writer.out.reserve(json_size_hint<X>::get());
+
+		rpoco::visit<X,json_writer>(writer,x);
+		json_size_hint<X>::update(writer.out.size());
+		writer.out.swap(out);
+	}
+	template<typename X> bool to_json(X &x,json_sink &sink,const write_options &opts) {
+		json_writer writer(&sink,opts);
+
+		rpoco::visit<X,json_writer>(writer,x);
+		return writer.finish();
+	}
+	template<typename X> bool to_json(X &x,std::ostream &out,const write_options &opts) {
+		ostream_sink sink(out);
+		return to_json(x,sink,opts);
+	}
+	template<typename X> size_t to_json(X &x,char *buf,size_t capacity,const write_options &opts) {
+		// the writer keeps the configured block size, the sink copies the
+		// blocks into the buffer so large buffers aren't mirrored in memory.
+		fixed_sink sink(buf,capacity);
+		to_json(x,sink,opts);
+		return sink.size;
+	}
+
+	template<typename X> void to_json(X &x,json_iovec &out,const write_options &opts) {
+		json_writer writer(0,opts);
+		// the generated text buffer is reused
+		out.m_buf.clear();
+		out.m_pieces.clear();
+		writer.out.swap(out.m_buf);
+		writer.iov=&out;
+
+		rpoco::visit<X,json_writer>(writer,x);
+		writer.finish_iov();
+		writer.out.swap(out.m_buf);
+		out.build();
+	}
+
+	// a resumable writer that produces the JSON text of an object on demand
+	// so that large documents can be sent as the output becomes writable.
+	// RPOCO objects, vectors (also in the columnar form), maps and JSON
+	// values are traversed with an explicit stack of frames so that the
+	// traversal can stop between any two elements, other values are
+	// written whole. The object must be kept alive and
+	// unchanged until the output is done.
+	class json_pull_writer {
+		// traversal state of a container being written
+		struct frame {
+			void *obj;
+			size_t idx;
+			// write the next element or end the container and pop the frame
+			void (*step)(json_pull_writer &w);
+			// RPOCO object written as an array of values
+			bool positional;
+			// storage for container iterators
+			alignas(void*) unsigned char it[4*sizeof(void*)];
+		};
+		json_writer m_writer;
+		std::vector<frame> m_stack;
+		// read position in the writer output
+		size_t m_pos;
+
+		frame& push(void *obj,void (*step)(json_pull_writer &w)) {
+			m_stack.push_back(frame());
+			frame &f=m_stack.back();
+			f.obj=obj;
+			f.idx=0;
+			f.step=step;
+			f.positional=false;
+			return f;
+		}
+		// traversal of a type, types without a specialization are written whole
+		template<typename F,typename=void> struct traverse {
+			static void start(json_pull_writer &w,F &f) {
+				rpoco::visit<F,json_writer>(w.m_writer,f);
+			}
+		};
+		// RPOCO objects step through their members in declaration order
+		template<typename F> struct traverse<F,typename std::enable_if<rpoco::is_rpoco<F>::value>::type> {
+			typedef rpoco::type_info_table_of<F> table;
+			template<size_t I> static void member(json_pull_writer &w,F &f) {
+				typedef typename table::template field_at<I> field;
+				if (w.m_stack.back().positional) {
+					traverse<typename field::type>::start(w,f.*field::pointer);
+					return;
 				}
+				if (w.m_writer.template omit_member<F,I>(f))
+					return;
+				w.m_writer.template produce_member<F,I>();
+				traverse<typename field::type>::start(w,f.*field::pointer);
 			}
-			// post-value, update state
-			void post() {
-				switch(state.back()) {
-				case ary :
-					state.back()=arynxt;
-					break;
-				case objid :
-					out.append(":");
-					state.back()=objval;
-					break;
-				case objval :
-					state.back()=objnxt;
-					break;
-				case def:
-					state.back()=end;
-					break;
+			template<size_t... I> static constexpr std::array<void(*)(json_pull_writer&,F&),sizeof...(I)> members(std::index_sequence<I...>) {
+				return {{ &member<I>... }};
+			}
+			static constexpr auto fns=members(std::make_index_sequence<json_keys<F>::count>());
+			static void step(json_pull_writer &w) {
+				frame &fr=w.m_stack.back();
+				F &f=*(F*)fr.obj;
+				if (fr.idx<fns.size()) {
+					size_t i=fr.idx++;
+					fns[i](w,f);
+				} else {
+					bool positional=fr.positional;
+					w.m_stack.pop_back();
+					w.m_writer.produce_end(positional ? rpoco::vt_array : rpoco::vt_object);
 				}
 			}
-			// called when entering a object or array
-			// responsible for updating the state stack
-			virtual void produce_start(rpoco::visit_type vt) {
-				switch(vt) {
-				case rpoco::vt_object :
-					// update the previous level
-					pre(false);
-					// print and setup the object
-					out.append("{");
-					state.push_back(objid);
-					break;
-				case rpoco::vt_array :
-					// update the previous level
-					pre(false);
-					// print and setup the array
-					out.append("[");
-					state.push_back(ary);
-					break;
-				default:
-					abort();
+			static void start(json_pull_writer &w,F &f) {
+				bool positional=w.m_writer.template produce_positional<F>();
+				w.m_writer.produce_start(positional ? rpoco::vt_array : rpoco::vt_object);
+				w.push(&f,&step).positional=positional;
+			}
+		};
+		template<typename E,typename A> struct traverse<std::vector<E,A>> {
+			static constexpr bool columnar=rpoco::is_rpoco<E>::value;
+			// columnar rows are RPOCO objects written positionally
+			static void row_step(json_pull_writer &w) {
+				frame &fr=w.m_stack.back();
+				std::vector<E,A> &v=*(std::vector<E,A>*)fr.obj;
+				if (fr.idx<v.size()) {
+					size_t i=fr.idx++;
+					w.m_writer.produce_start(rpoco::vt_array);
+					w.push(&v[i],&traverse<E>::step).positional=true;
+				} else {
+					w.m_stack.pop_back();
+					w.m_writer.produce_end(rpoco::vt_array);
+					w.m_writer.produce_end(rpoco::vt_object);
 				}
 			}
-			// visitor interface to query production or consumption mode
-			virtual bool consume(rpoco::visit_type vt,std::function<void (std::string&)> g) {
-				// the generator does not consume anything, return false
-				return false;
+			static void step(json_pull_writer &w) {
+				frame &fr=w.m_stack.back();
+				std::vector<E,A> &v=*(std::vector<E,A>*)fr.obj;
+				if (fr.idx<v.size()) {
+					size_t i=fr.idx++;
+					traverse<E>::start(w,v[i]);
+				} else {
+					w.m_stack.pop_back();
+					w.m_writer.produce_end(rpoco::vt_array);
+				}
 			}
-			// called to produce the object end
-			virtual void produce_end(rpoco::visit_type vt) {
-				switch(vt) {
-				case rpoco::vt_object :
-					// sanity check
-					if (state.back()!=objid && state.back()!=objnxt)
-						abort();
-					// exit object
-					state.pop_back();
-					out.append("}");
-					// call parent state to indicate end-of-value
-					post();
-					break;
-				case rpoco::vt_array :
-					// sanity check
-					if (state.back()!=ary && state.back()!=arynxt)
-						abort();
-					// exit array
-					state.pop_back();
-					out.append("]");
-					// call parent state to indicate end-of-value
-					post();
-					break;
-				default:
-					abort();
+			static void start(json_pull_writer &w,std::vector<E,A> &v) {
+				if constexpr (columnar) {
+					if (w.m_writer.produce_columns(rpoco::type_info_of<E>())) {
+						w.m_writer.produce_start(rpoco::vt_array);
+						w.push(&v,&row_step);
+						return;
+					}
 				}
+				w.m_writer.produce_start(rpoco::vt_array);
+				w.push(&v,&step);
 			}
-			// boolean visitor
-			virtual void visit(bool& bv) {
-				// sanity check
-				if (state.back()==objid)
-					abort();
-				// inform parent of value start
-				pre(false);
-				// dump value
-				out.append(bv?"true":"false");
-				// inform parent of value end
-				post();
-			}
-			// double visitor
-			virtual void visit(double& dv) {
-				// sanity check
-				if (state.back()==objid)
-					abort();
-				// inform parent of value start
-				pre(false);
-				// dump double string
-				char buf[500];
-#ifdef _MSC_VER
-				sprintf_s(buf,sizeof(buf),"%.17g",dv);
-#else
-				snprintf(buf,sizeof(buf),"%.17g",dv);
-#endif
-				// replace commas in locales where
-				// they appear.
-				for (int i=0;buf[i];i++)
-					if (buf[i]==',')
-						buf[i]='.';
-				out.append(buf);
-				// inform parent of value end
-				post();
+		};
+		template<typename E> struct traverse<std::map<std::string,E>> {
+			typedef typename std::map<std::string,E>::iterator iterator;
+			static_assert(sizeof(iterator)<=sizeof(frame::it) && std::is_trivially_copyable<iterator>::value,"map iterators does not fit the frame");
+			static void step(json_pull_writer &w) {
+				frame &fr=w.m_stack.back();
+				std::map<std::string,E> &m=*(std::map<std::string,E>*)fr.obj;
+				iterator &it=*(iterator*)fr.it;
+				if (it!=m.end()) {
+					std::pair<const std::string,E> &p=*it++;
+					w.m_writer.produce_name(p.first);
+					traverse<E>::start(w,p.second);
+				} else {
+					w.m_stack.pop_back();
+					w.m_writer.produce_end(rpoco::vt_object);
+				}
 			}
-			// integer visitor
-			virtual void visit(int& iv) {
-				// sanity check
-				if (state.back()==objid)
-					abort();
-				// inform parent of value start
-				pre(false);
-				// dump integer string
-				out.append(std::to_string(iv));
-				// inform parent of value end
-				post();
+			static void start(json_pull_writer &w,std::map<std::string,E> &m) {
+				w.m_writer.produce_start(rpoco::vt_object);
+				frame &fr=w.push(&m,&step);
+				new (fr.it) iterator(m.begin());
 			}
-			// get 1 hex character
-			char toHex(int c) {
-				c&=0xf;
-				if (c<10)
-					return c+'0';
+		};
+		// pointers are followed to their targets
+		template<typename E> struct traverse<E*> {
+			static void start(json_pull_writer &w,E *p) {
+				if (p)
+					traverse<E>::start(w,*p);
 				else
-					return c-10+'A';
-			}
-			// dump JSON UTF16 codepoint
-			void dumpUniEscape( int c) {
-				out.append("\\u");
-				out.push_back( toHex(c>>12) );
-				out.push_back( toHex(c>>8) );
-				out.push_back( toHex(c>>4) );
-				out.push_back( toHex(c) );
-			}
-			// visit null terminated string
-			virtual void visit(char *str,size_t sz) {
-				// TODO: encapsulate to avoid copy and construction
-				for (size_t i=0;i<sz;i++)
-					if (!str[i])
-						sz=i;
-				std::string tmp(str,sz);
-				visit(tmp);
-			}
-			virtual void visit(std::string &str) {
-				struct strsrc {
-					std::string *p;
-					int idx;
-					strsrc(std::string *s) {
-						idx=0;
-						p=s;
-					}
-					int peek() {
-						if (idx==p->size())
-							return EOF;
-						return ((*p)[idx])&0xff;
-					}
-					int get() {
-						int c=peek();
-						if (c!=EOF) idx++;
-						return c;
-					}
-				}src(&str);
-				pre(true);
-				out.append("\"");
-				// TODO: proper string encoding
-				//out.append(str);
-				while(src.peek()!=EOF) {
-					int c=read_utf8(src);
-					//printf("Encoding:%d (%c)\n",c,c);
-					switch(c) {
-					case '\"' :
-						out.append("\\\"");
-						continue;
-					case '\\' :
-						out.append("\\\\");
-						continue;
-					//case '/' :
-					//	out.append("\\/");
-					//	continue;
-					case '\b' :
-						out.append("\\b");
-						continue;
-					case '\f' :
-						out.append("\\f");
-						continue;
-					case '\n' :
-						out.append("\\n");
-						continue;
-					case '\r' :
-						out.append("\\r");
-						continue;
-					case '\t' :
-						out.append("\\t");
-						continue;
-					}
-					if (c>=32 && c<127) {
-						out.push_back((char)c);
-					} else if (c>0x10ffff) {
-						abort(); // out of range character
-					} else if (c>0xffff) {
-						c-=0x10000;
-						dumpUniEscape( 0xd800 | ((c>>10)&0x3ff) );
-						dumpUniEscape( 0xdc00 | (c&0x3ff) );
-					} else {
-						dumpUniEscape( c );
-					}
-				}
-				out.append("\"");
-				post();
+					w.m_writer.visit_null();
 			}
-			virtual rpoco::visit_type peek() {
-				return rpoco::vt_none;
+		};
+		template<typename E> struct traverse<std::shared_ptr<E>> {
+			static void start(json_pull_writer &w,std::shared_ptr<E> &p) {
+				traverse<E*>::start(w,p.get());
 			}
-			virtual void visit_null() {
-				pre(false);
-				out.append("null");
-				post();
+		};
+		template<typename E> struct traverse<std::unique_ptr<E>> {
+			static void start(json_pull_writer &w,std::unique_ptr<E> &p) {
+				traverse<E*>::start(w,p.get());
 			}
 		};
-		json_writer writer;
-
-		rpoco::visit<X>(writer,x);
-		return writer.out;
-	}
+		// JSON values step through arrays and objects, defined after json_value
+		template<typename V> struct traverse<json_value,V>;
+	public:
+		template<typename X> json_pull_writer(X &x,const write_options &opts=write_options()) : m_writer(0,opts),m_pos(0) {
+			traverse<X>::start(*this,x);
+		}
+		json_pull_writer(const json_pull_writer&)=delete;
+		json_pull_writer& operator=(const json_pull_writer&)=delete;
+		// true when all output has been read
+		bool done() const {
+			return m_stack.empty() && m_pos==m_writer.out.size();
+		}
+		// copy up to sz bytes of the next output to buf, returns the number of
+		// bytes copied (only 0 when done). Each call only traverses as much of
+		// the object as is needed to fill the request.
+		size_t read(char *buf,size_t sz) {
+			std::string &out=m_writer.out;
+			while(out.size()-m_pos<sz && !m_stack.empty())
+				m_stack.back().step(*this);
+			size_t n=out.size()-m_pos;
+			if (n>sz)
+				n=sz;
+			memcpy(buf,out.data()+m_pos,n);
+			m_pos+=n;
+			// drop consumed output so that the buffer stays bounded
+			if (m_pos==out.size()) {
+				out.clear();
+				m_pos=0;
+			} else if (m_pos>=4096 && m_pos*2>=out.size()) {
+				out.erase(0,m_pos);
+				m_pos=0;
+			}
+			return n;
+		}
+	};
 
+	class json_object;
 	// a generic catch-all class that can have any kind of JSON data.
+	// values are compact 16 byte nodes, strings of up to 14 bytes are stored
+	// inline and longer strings in a single allocation. Objects keep their
+	// members in a flat array (see json_object below).
+	// Storage is taken from a memory resource, the heap unless the value
+	// is created by a parser with a resource (or given one explicitly). Trees allocated from an arena can be abandoned with
+	// release() before resetting the arena, skipping the destruction walk.
 	class json_value {
-		rpoco::visit_type m_type;
+		// heap storage of long strings, the characters follow the size
+		struct string_data {
+			std::pmr::memory_resource *mr;
+			size_t size;
+			char chars[1];
+		};
 		union {
 			bool b;
 			double n;
-			std::string *s;
-			std::vector<json_value> *a;
-			std::map<std::string,json_value> *o;
-		}data;
-		void copy_from(const json_value &other) {
-			set_type(other.m_type);
-			switch(other.m_type) {
-			case rpoco::vt_array :
-				*data.a=*other.data.a;
-				break;
-			case rpoco::vt_object :
-				*data.o=*other.data.o;
-				break;
-			case rpoco::vt_string :
-				*data.s=*other.data.s;
-				break;
-			case rpoco::vt_bool :
-				data.b=other.data.b;
-				break;
-			case rpoco::vt_number :
-				data.n=other.data.n;
-				break;
-			}
+			string_data *s;
+			std::pmr::vector<json_value> *a;
+			json_object *o;
+		} data;
+		// small strings continue from the data bytes into these
+		char m_chars[6];
+		// length of a small string or heap_string
+		uint8_t m_len;
+		uint8_t m_type;
+		static const uint8_t heap_string=0xff;
+		static const size_t small_size=14;
+		char* small_chars() {
+			return reinterpret_cast<char*>(this);
+		}
+		const char* small_chars() const {
+			return reinterpret_cast<const char*>(this);
 		}
+		void copy_from(const json_value &other);
 	public:
 		json_value() {
 			m_type=rpoco::vt_null;
@@ -773,10 +1817,38 @@ namespace rpocojson {
 			m_type=rpoco::vt_null;
 			copy_from(other);
 		}
+		json_value(std::string_view sv) {
+			m_type=rpoco::vt_null;
+			set_string(sv);
+		}
+		// assignments build the new contents before the old ones are destroyed
+		// as the source may be owned by this value (v=(*v.array())[0])
 		json_value& operator=(const json_value &other) {
-			copy_from(other);
+			if (this!=&other) {
+				json_value tmp(other);
+				swap(tmp);
+			}
 			return *this;
 		}
+		// nodes own their storage through a pointer (or inline) so moves just
+		// take over the node bytes and leave the source as null.
+		json_value(json_value &&other) noexcept {
+			memcpy((void*)this,(const void*)&other,sizeof(json_value));
+			other.m_type=rpoco::vt_null;
+		}
+		json_value& operator=(json_value &&other) noexcept {
+			if (this!=&other) {
+				json_value tmp(std::move(other));
+				swap(tmp);
+			}
+			return *this;
+		}
+		void swap(json_value &other) noexcept {
+			char tmp[sizeof(json_value)];
+			memcpy(tmp,(const void*)this,sizeof(json_value));
+			memcpy((void*)this,(const void*)&other,sizeof(json_value));
+			memcpy((void*)&other,tmp,sizeof(json_value));
+		}
 		void set_null() {
 			set_type(rpoco::vt_null);
 		}
@@ -790,88 +1862,296 @@ namespace rpocojson {
 			data.b=b;
 			return *this;
 		}
-		json_value& operator=(std::string s) {
-			set_type(rpoco::vt_string);
-			*data.s=s;
+		json_value& operator=(const std::string &s) {
+			set_string(s);
+			return *this;
+		}
+		json_value& operator=(std::string_view sv) {
+			set_string(sv);
+			return *this;
+		}
+		json_value& operator=(const char *str) {
+			set_string(str);
+			return *this;
+		}
+		// arrays and objects can be moved in without copying the elements
+		// (arrays on another resource are moved element by element)
+		json_value& operator=(std::pmr::vector<json_value> &&a) {
+			json_value tmp;
+			tmp.set_type(rpoco::vt_array,a.get_allocator().resource());
+			tmp.data.a->swap(a);
+			swap(tmp);
+			return *this;
+		}
+		json_value& operator=(std::vector<json_value> &&a) {
+			set_type(rpoco::vt_array);
+			data.a->assign(std::make_move_iterator(a.begin()),std::make_move_iterator(a.end()));
+			a.clear();
 			return *this;
 		}
-		rpoco::visit_type type() {
-			return m_type;
+		inline json_value& operator=(json_object &&o);
+		// set a string value, short strings are stored inline. The string is
+		// built in a temporary before the old contents are destroyed as sv
+		// may point into this value (v=v.str()).
+		void set_string(std::string_view sv,std::pmr::memory_resource *mr=0) {
+			json_value tmp;
+			tmp.m_type=rpoco::vt_string;
+			if (sv.size()<=small_size) {
+				memcpy(tmp.small_chars(),sv.data(),sv.size());
+				tmp.m_len=(uint8_t)sv.size();
+			} else {
+				if (!mr)
+					mr=rpoco::heap_resource::shared();
+				tmp.data.s=(string_data*)mr->allocate(offsetof(string_data,chars)+sv.size(),alignof(string_data));
+				tmp.data.s->mr=mr;
+				tmp.data.s->size=sv.size();
+				memcpy(tmp.data.s->chars,sv.data(),sv.size());
+				tmp.m_len=heap_string;
+			}
+			swap(tmp);
+		}
+		rpoco::visit_type type() const {
+			return (rpoco::visit_type)m_type;
 		}
-		bool to_bool() {
+		bool to_bool() const {
 			if (m_type==rpoco::vt_bool) {
 				return data.b;
 			} else {
 				return false;
 			}
 		}
-		double to_number() {
+		double to_number() const {
 			if (m_type==rpoco::vt_number) {
 				return data.n;
 			} else {
 				return 0;
 			}
 		}
-		std::string to_string() {
-			if (m_type==rpoco::vt_string) {
-				return *data.s;
-			} else {
-				return std::string("");
-			}
+		// the string data without copying (empty for non-strings)
+		std::string_view str() const {
+			if (m_type!=rpoco::vt_string)
+				return std::string_view();
+			if (m_len==heap_string)
+				return std::string_view(data.s->chars,data.s->size);
+			return std::string_view(small_chars(),m_len);
+		}
+		std::string to_string() const {
+			return std::string(str());
+		}
+		json_object* map() {
+			if (m_type!=rpoco::vt_object)
+				return 0;
+			return data.o;
 		}
-		std::map<std::string,json_value>* map() {
+		const json_object* map() const {
 			if (m_type!=rpoco::vt_object)
 				return 0;
 			return data.o;
 		}
-		std::vector<json_value>* array() {
+		std::pmr::vector<json_value>* array() {
 			if (m_type!=rpoco::vt_array)
 				return 0;
 			return data.a;
 		}
-		void set_type(rpoco::visit_type toType) {
-			if (m_type!=toType) {
-				switch(m_type) {
-				case rpoco::vt_string :
-					delete data.s;
-					break;
-				case rpoco::vt_array :
-					delete data.a;
-					break;
-				case rpoco::vt_object :
-					delete data.o;
-					break;
-				}
-				switch(toType) {
-				case rpoco::vt_array :
-					data.a=new std::vector<json_value>();
-					break;
-				case rpoco::vt_object :
-					data.o=new std::map<std::string,json_value>();
-					break;
-				case rpoco::vt_string :
-					data.s=new std::string();
-					break;
-				case rpoco::vt_number :
-					data.n=0;
-					break;
-				case rpoco::vt_bool :
-					data.b=false;
-					break;
-				}
-			}
-			m_type=toType;
+		const std::pmr::vector<json_value>* array() const {
+			if (m_type!=rpoco::vt_array)
+				return 0;
+			return data.a;
+		}
+		// change the type, arrays and objects are created on mr (0 for the heap)
+		inline void set_type(rpoco::visit_type toType,std::pmr::memory_resource *mr=0);
+		// drop the contents without freeing them, only for values
+		// whose storage is released elsewhere (like an arena reset)
+		void release() {
+			m_type=rpoco::vt_null;
 		}
 		~json_value() {
 			set_type(rpoco::vt_null);
 		}
 	};
+	static_assert(sizeof(json_value)==16,"json_value should be a 16 byte node");
+
+	// a member of a JSON object
+	struct json_member {
+		json_value name; // always a string
+		json_value value;
+	};
+
+	// the members of a JSON object in a flat array kept in insertion order,
+	// small objects are searched linearly and objects with many members
+	// also get a hash index for lookups.
+	class json_object {
+		std::pmr::vector<json_member> m_members;
+		// open addressing index of member positions+1 (0 is empty), only used for large objects
+		std::pmr::vector<uint32_t> m_index;
+		static const size_t index_min=16;
+		static size_t hash(std::string_view name) {
+			return (size_t)rpoco::hash_name(name);
+		}
+		void index_insert(size_t pos) {
+			size_t mask=m_index.size()-1;
+			size_t i=hash(m_members[pos].name.str())&mask;
+			while(m_index[i])
+				i=(i+1)&mask;
+			m_index[i]=(uint32_t)pos+1;
+		}
+		void rebuild_index() {
+			size_t sz=index_min*2;
+			while(sz<m_members.size()*2)
+				sz*=2;
+			m_index.assign(sz,0);
+			for (size_t i=0;i<m_members.size();i++)
+				index_insert(i);
+		}
+	public:
+		typedef std::pmr::vector<json_member>::iterator iterator;
+		typedef std::pmr::vector<json_member>::const_iterator const_iterator;
+		json_object() : json_object(rpoco::heap_resource::shared()) {}
+		explicit json_object(std::pmr::memory_resource *mr) : m_members(mr),m_index(mr) {}
+		// the resource used for the members and their names
+		std::pmr::memory_resource* resource() const {
+			return m_members.get_allocator().resource();
+		}
+		size_t size() const {
+			return m_members.size();
+		}
+		bool empty() const {
+			return m_members.empty();
+		}
+		iterator begin() {
+			return m_members.begin();
+		}
+		iterator end() {
+			return m_members.end();
+		}
+		const_iterator begin() const {
+			return m_members.begin();
+		}
+		const_iterator end() const {
+			return m_members.end();
+		}
+		// get a member value by name, null if the member does not exist
+		json_value* find(std::string_view name) {
+			if (!m_index.empty()) {
+				size_t mask=m_index.size()-1;
+				for (size_t i=hash(name)&mask;m_index[i];i=(i+1)&mask) {
+					json_member &m=m_members[m_index[i]-1];
+					if (m.name.str()==name)
+						return &m.value;
+				}
+				return 0;
+			}
+			for (json_member &m:m_members)
+				if (m.name.str()==name)
+					return &m.value;
+			return 0;
+		}
+		size_t count(std::string_view name) {
+			return find(name) ? 1 : 0;
+		}
+		// const lookup of a member value, null if the member does not exist
+		const json_value* find(std::string_view name) const {
+			return const_cast<json_object*>(this)->find(name);
+		}
+		// get a member value, adding a null member if it does not exist
+		json_value& operator[](std::string_view name) {
+			if (json_value *v=find(name))
+				return *v;
+			m_members.emplace_back();
+			m_members.back().name.set_string(name,resource());
+			if (m_members.size()>=index_min) {
+				if (m_index.size()<m_members.size()*2)
+					rebuild_index();
+				else
+					index_insert(m_members.size()-1);
+			}
+			return m_members.back().value;
+		}
+		void clear() {
+			m_members.clear();
+			m_index.clear();
+		}
+	};
+
+	inline json_value& json_value::operator=(json_object &&o) {
+		json_value tmp;
+		tmp.set_type(rpoco::vt_object);
+		*tmp.data.o=std::move(o);
+		swap(tmp);
+		return *this;
+	}
+	inline void json_value::copy_from(const json_value &other) {
+		switch(other.m_type) {
+		case rpoco::vt_array :
+			set_type(rpoco::vt_array);
+			*data.a=*other.data.a;
+			break;
+		case rpoco::vt_object :
+			set_type(rpoco::vt_object);
+			*data.o=*other.data.o;
+			break;
+		case rpoco::vt_string :
+			set_string(other.str());
+			break;
+		case rpoco::vt_bool :
+			set_type(rpoco::vt_bool);
+			data.b=other.data.b;
+			break;
+		case rpoco::vt_number :
+			set_type(rpoco::vt_number);
+			data.n=other.data.n;
+			break;
+		default:
+			set_type(rpoco::vt_null);
+			break;
+		}
+	}
+	inline void json_value::set_type(rpoco::visit_type toType,std::pmr::memory_resource *mr) {
+		if (m_type!=toType) {
+			switch(m_type) {
+			case rpoco::vt_string :
+				if (m_len==heap_string)
+					data.s->mr->deallocate(data.s,offsetof(string_data,chars)+data.s->size,alignof(string_data));
+				break;
+			case rpoco::vt_array : {
+					std::pmr::memory_resource *amr=data.a->get_allocator().resource();
+					data.a->~vector();
+					amr->deallocate(data.a,sizeof(*data.a),alignof(std::pmr::vector<json_value>));
+				} break;
+			case rpoco::vt_object : {
+					std::pmr::memory_resource *omr=data.o->resource();
+					data.o->~json_object();
+					omr->deallocate(data.o,sizeof(json_object),alignof(json_object));
+				} break;
+			}
+			if (!mr)
+				mr=rpoco::heap_resource::shared();
+			switch(toType) {
+			case rpoco::vt_array :
+				data.a=new (mr->allocate(sizeof(std::pmr::vector<json_value>),alignof(std::pmr::vector<json_value>))) std::pmr::vector<json_value>(mr);
+				break;
+			case rpoco::vt_object :
+				data.o=new (mr->allocate(sizeof(json_object),alignof(json_object))) json_object(mr);
+				break;
+			case rpoco::vt_string :
+				m_len=0;
+				break;
+			case rpoco::vt_number :
+				data.n=0;
+				break;
+			case rpoco::vt_bool :
+				data.b=false;
+				break;
+			}
+		}
+		m_type=(uint8_t)toType;
+	}
 }
 
 namespace rpoco {
 	// create a specialization visitor for rpocojson::json_value to enable
 	// it to work coherently with the rest of the rpoco types.
-	template<> struct visit<rpocojson::json_value> { visit (visitor &v,rpocojson::json_value &jv) {
+	template<typename V> struct visit<rpocojson::json_value,V> { visit (V &v,rpocojson::json_value &jv) {
 		if (v.peek()==vt_none) {
 			switch(jv.type()) {
 			case vt_null : {
@@ -886,27 +2166,19 @@ namespace rpoco {
 					v.visit(b);
 				} break;
 			case vt_string : {
-					std::string str=jv.to_string();
+					std::string_view str=jv.str();
 					v.visit(str);
 				} break;
-			case vt_object :
-				rpoco::visit<std::map<std::string,rpocojson::json_value>>(v,*jv.map());
-				//v.produce_start(rpoco::vt_object);
-				//jv.object_items([&v](std::string &n,rpocojson::json_value &sv){
-				//	v.visit(n);
-				//	visit(v,sv);
-				//});
-				//v.produce_end(rpoco::vt_array);
-				break;
+			case vt_object : {
+					v.produce_start(vt_object);
+					for (rpocojson::json_member &m:*jv.map()) {
+						v.produce_name(m.name.str());
+						rpoco::visit<rpocojson::json_value,V>(v,m.value);
+					}
+					v.produce_end(vt_object);
+				} break;
 			case vt_array : {
-					rpoco::visit<std::vector<rpocojson::json_value>>(v,*jv.array());
-					//std::string tmp("");
-					//v.produce_start(rpoco::vt_object);
-					//jv.array_items([&v,&tmp](int idx,rpocojson::json_value &sv){
-					//	v.visit(tmp);
-					//	visit(v,sv);
-					//});
-					//v.produce_end(rpoco::vt_array);
+					rpoco::visit<std::pmr::vector<rpocojson::json_value>,V>(v,*jv.array());
 				} break;
 			default:
 				abort();
@@ -929,17 +2201,23 @@ namespace rpoco {
 					jv=b;
 				} break;
 			case vt_string : {
-					std::string s;
-					v.visit(s);
-					jv=s;
+					// decode into a reused buffer and store directly in the node
+					static thread_local std::string tmp;
+					tmp.clear();
+					v.visit(tmp);
+					jv.set_string(tmp,v.memory_resource());
 				} break;
 			case vt_object : {
-					jv.set_type(rpoco::vt_object);
-					rpoco::visit<std::map<std::string,rpocojson::json_value>>(v,*jv.map());
+					jv.set_type(rpoco::vt_object,v.memory_resource());
+					rpocojson::json_object &o=*jv.map();
+					// duplicate names keep the last value
+					v.consume(vt_object,[&v,&o](const name_ref& n) {
+						rpoco::visit<rpocojson::json_value,V>(v,o[n.name]);
+					});
 				} break;
 			case vt_array : {
-					jv.set_type(rpoco::vt_array);
-					rpoco::visit<std::vector<rpocojson::json_value>>(v,*jv.array());
+					jv.set_type(rpoco::vt_array,v.memory_resource());
+					rpoco::visit<std::pmr::vector<rpocojson::json_value>,V>(v,*jv.array());
 				} break;
 			}
 		}
@@ -947,5 +2225,291 @@ namespace rpoco {
 
 }
 
+namespace rpocojson {
+	template<typename V> struct json_pull_writer::traverse<json_value,V> {
+		static void object_step(json_pull_writer &w) {
+			frame &fr=w.m_stack.back();
+			json_object &o=*(json_object*)fr.obj;
+			if (fr.idx<o.size()) {
+				json_member &m=o.begin()[fr.idx++];
+				w.m_writer.produce_name(m.name.str());
+				start(w,m.value);
+			} else {
+				w.m_stack.pop_back();
+				w.m_writer.produce_end(rpoco::vt_object);
+			}
+		}
+		static void start(json_pull_writer &w,json_value &jv) {
+			switch(jv.type()) {
+			case rpoco::vt_array :
+				traverse<std::pmr::vector<json_value>>::start(w,*jv.array());
+				break;
+			case rpoco::vt_object :
+				w.m_writer.produce_start(rpoco::vt_object);
+				w.push(jv.map(),&object_step);
+				break;
+			default:
+				rpoco::visit<json_value,json_writer>(w.m_writer,jv);
+			}
+		}
+	};
+
+	// a read-only JSON document stored as a flat tape of 64 bit words and a
+	// string buffer, the buffers are kept when another document is read into
+	// the tape. Every value is two words, the first has the type in the top
+	// byte. Numbers have the double bits in the second word, strings have the
+	// buffer offset in the first word and the length in the second. Arrays
+	// and objects have the tape position after their contents in the first
+	// word and the number of elements in the second, object members are
+	// stored as a name string followed by the value.
+	class json_tape {
+		template<typename F,typename V> friend struct rpoco::visit;
+		std::vector<uint64_t> m_tape;
+		std::string m_strings;
+		static const uint64_t payload_mask=0x00ffffffffffffffULL;
+		rpoco::visit_type type_at(size_t pos) const {
+			return (rpoco::visit_type)(m_tape[pos]>>56);
+		}
+		uint64_t payload_at(size_t pos) const {
+			return m_tape[pos]&payload_mask;
+		}
+		std::string_view string_at(size_t pos) const {
+			return std::string_view(m_strings.data()+payload_at(pos),(size_t)m_tape[pos+1]);
+		}
+		// the position of the value after the one at pos
+		size_t next(size_t pos) const {
+			rpoco::visit_type t=type_at(pos);
+			return t==rpoco::vt_object || t==rpoco::vt_array ? (size_t)payload_at(pos) : pos+2;
+		}
+		size_t append(rpoco::visit_type t,uint64_t payload,uint64_t second) {
+			m_tape.push_back(((uint64_t)t<<56)|payload);
+			m_tape.push_back(second);
+			return m_tape.size()-2;
+		}
+		void append_string(std::string_view str) {
+			append(rpoco::vt_string,m_strings.size(),str.size());
+			m_strings.append(str);
+		}
+		// containers are finished when the contents are known
+		void close(size_t pos,size_t count) {
+			m_tape[pos]|=m_tape.size();
+			m_tape[pos+1]=count;
+		}
+	public:
+		class iterator;
+		// a reference to a value in the tape, missing values have the type vt_none
+		class element {
+			friend class json_tape;
+			const json_tape *m_tape;
+			size_t m_pos;
+			element(const json_tape *t,size_t pos) : m_tape(t),m_pos(pos) {}
+		public:
+			element() : m_tape(0),m_pos(0) {}
+			rpoco::visit_type type() const {
+				return m_tape ? m_tape->type_at(m_pos) : rpoco::vt_none;
+			}
+			bool to_bool() const {
+				return type()==rpoco::vt_bool && m_tape->payload_at(m_pos)!=0;
+			}
+			double to_number() const {
+				double d=0;
+				if (type()==rpoco::vt_number)
+					memcpy(&d,&m_tape->m_tape[m_pos+1],sizeof(d));
+				return d;
+			}
+			std::string_view str() const {
+				if (type()!=rpoco::vt_string)
+					return std::string_view();
+				return m_tape->string_at(m_pos);
+			}
+			std::string to_string() const {
+				return std::string(str());
+			}
+			// the number of array elements or object members
+			size_t size() const {
+				rpoco::visit_type t=type();
+				return t==rpoco::vt_object || t==rpoco::vt_array ? (size_t)m_tape->m_tape[m_pos+1] : 0;
+			}
+			// array element i, found by skipping over the preceding elements
+			element operator[](size_t i) const {
+				if (type()!=rpoco::vt_array || i>=size())
+					return element();
+				size_t pos=m_pos+2;
+				while(i--)
+					pos=m_tape->next(pos);
+				return element(m_tape,pos);
+			}
+			// the value of the named member (the first one if there are duplicates)
+			element find(std::string_view name) const {
+				if (type()!=rpoco::vt_object)
+					return element();
+				size_t end=(size_t)m_tape->payload_at(m_pos);
+				for (size_t pos=m_pos+2;pos<end;pos=m_tape->next(pos+2)) {
+					if (m_tape->string_at(pos)==name)
+						return element(m_tape,pos+2);
+				}
+				return element();
+			}
+			inline iterator begin() const;
+			inline iterator end() const;
+		};
+		// iterates the elements of arrays and the members of objects
+		class iterator {
+			friend class element;
+			const json_tape *m_tape;
+			size_t m_pos;
+			bool m_object;
+			iterator(const json_tape *t,size_t pos,bool object) : m_tape(t),m_pos(pos),m_object(object) {}
+		public:
+			// the member name (empty for array elements)
+			std::string_view name() const {
+				return m_object ? m_tape->string_at(m_pos) : std::string_view();
+			}
+			element operator*() const {
+				return element(m_tape,m_object ? m_pos+2 : m_pos);
+			}
+			iterator& operator++() {
+				m_pos=m_tape->next(m_object ? m_pos+2 : m_pos);
+				return *this;
+			}
+			bool operator==(const iterator &o) const {
+				return m_pos==o.m_pos;
+			}
+			bool operator!=(const iterator &o) const {
+				return m_pos!=o.m_pos;
+			}
+		};
+		// the document root, an empty tape has no root (vt_none)
+		element root() const {
+			return m_tape.empty() ? element() : element(this,0);
+		}
+		bool empty() const {
+			return m_tape.empty();
+		}
+		void clear() {
+			m_tape.clear();
+			m_strings.clear();
+		}
+	};
+	inline json_tape::iterator json_tape::element::begin() const {
+		rpoco::visit_type t=type();
+		if (t!=rpoco::vt_object && t!=rpoco::vt_array)
+			return iterator(m_tape,0,false);
+		return iterator(m_tape,m_pos+2,t==rpoco::vt_object);
+	}
+	inline json_tape::iterator json_tape::element::end() const {
+		rpoco::visit_type t=type();
+		if (t!=rpoco::vt_object && t!=rpoco::vt_array)
+			return iterator(m_tape,0,false);
+		return iterator(m_tape,(size_t)m_tape->payload_at(m_pos),t==rpoco::vt_object);
+	}
+}
+
+namespace rpoco {
+	// tapes are produced by walking the tape and consumed by appending the
+	// values in document order, a tape that is read into is cleared first.
+	template<typename V> struct visit<rpocojson::json_tape,V> {
+		visit(V &v,rpocojson::json_tape &t) {
+			if (v.peek()==vt_none) {
+				if (t.empty())
+					v.visit_null();
+				else
+					produce(v,t,0);
+			} else {
+				t.clear();
+				consume(v,t);
+			}
+		}
+		// produce the value at pos, returns the position after it
+		static size_t produce(V &v,rpocojson::json_tape &t,size_t pos) {
+			switch(t.type_at(pos)) {
+			case vt_null :
+				v.visit_null();
+				break;
+			case vt_bool : {
+					bool b=t.payload_at(pos)!=0;
+					v.visit(b);
+				} break;
+			case vt_number : {
+					double d;
+					memcpy(&d,&t.m_tape[pos+1],sizeof(d));
+					v.visit(d);
+				} break;
+			case vt_string : {
+					std::string_view str=t.string_at(pos);
+					v.visit(str);
+				} break;
+			case vt_object : {
+					size_t end=(size_t)t.payload_at(pos);
+					v.produce_start(vt_object);
+					for (pos+=2;pos<end;) {
+						v.produce_name(t.string_at(pos));
+						pos=produce(v,t,pos+2);
+					}
+					v.produce_end(vt_object);
+					return end;
+				}
+			case vt_array : {
+					size_t end=(size_t)t.payload_at(pos);
+					v.produce_start(vt_array);
+					for (pos+=2;pos<end;)
+						pos=produce(v,t,pos);
+					v.produce_end(vt_array);
+					return end;
+				}
+			default:
+				abort();
+			}
+			return pos+2;
+		}
+		static void consume(V &v,rpocojson::json_tape &t) {
+			switch(v.peek()) {
+			case vt_null : {
+					v.visit_null();
+					t.append(vt_null,0,0);
+				} break;
+			case vt_bool : {
+					bool b;
+					v.visit(b);
+					t.append(vt_bool,b ? 1 : 0,0);
+				} break;
+			case vt_number : {
+					double d;
+					v.visit(d);
+					uint64_t bits;
+					memcpy(&bits,&d,sizeof(bits));
+					t.append(vt_number,0,bits);
+				} break;
+			case vt_string : {
+					// decode into a reused buffer and append to the string buffer
+					static thread_local std::string tmp;
+					tmp.clear();
+					v.visit(tmp);
+					t.append_string(tmp);
+				} break;
+			case vt_object : {
+					size_t pos=t.append(vt_object,0,0),count=0;
+					v.consume(vt_object,[&v,&t,&count](const name_ref& n) {
+						t.append_string(n.name);
+						consume(v,t);
+						count++;
+					});
+					t.close(pos,count);
+				} break;
+			case vt_array : {
+					size_t pos=t.append(vt_array,0,0),count=0;
+					v.consume(vt_array,[&v,&t,&count](const name_ref&) {
+						consume(v,t);
+						count++;
+					});
+					t.close(pos,count);
+				} break;
+			default:
+				break;
+			}
+		}
+	};
+}
+
 #endif // __INCLUDED_RPOCOJSON_HPP__
 
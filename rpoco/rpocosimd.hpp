@@ -0,0 +1,414 @@
+// This header provides vectorized text scanning kernels used by the JSON
+// parser and writer. SSE2 and AVX2 versions are selected at compile time
+// depending on the target flags and every kernel has a scalar fallback.
+
+#ifndef __INCLUDED_RPOCOSIMD_HPP__
+#define __INCLUDED_RPOCOSIMD_HPP__
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RPOCO_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define RPOCO_SSE2 1
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define RPOCO_SSSE3 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace rpoco {
+	// index of the lowest set bit of a non-zero mask
+	inline int lowest_bit(uint32_t m) {
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward(&idx,m);
+		return (int)idx;
+#else
+		return __builtin_ctz(m);
+#endif
+	}
+
+	// whitespace as accepted by the parser (same set as std::isspace in the C locale)
+	inline bool is_space(uint8_t c) {
+		return c==' ' || (c>=9 && c<=13);
+	}
+
+	// characters that ends a plain run inside a JSON string: quote, backslash and control codes
+	inline bool is_string_special(uint8_t c) {
+		return c=='"' || c=='\\' || c<32;
+	}
+	// characters the writer needs to escape for ASCII output, string specials and everything above 126
+	inline bool is_escape_special(uint8_t c) {
+		return is_string_special(c) || c>=127;
+	}
+
+#if RPOCO_SSE2
+	// byte masks for 16 characters at a time
+	inline __m128i space_mask(__m128i x) {
+		__m128i ge9=_mm_cmpeq_epi8(_mm_max_epu8(x,_mm_set1_epi8(9)),x);
+		__m128i le13=_mm_cmpeq_epi8(_mm_min_epu8(x,_mm_set1_epi8(13)),x);
+		return _mm_or_si128(_mm_cmpeq_epi8(x,_mm_set1_epi8(' ')),_mm_and_si128(ge9,le13));
+	}
+	inline __m128i string_special_mask(__m128i x) {
+		__m128i ctl=_mm_cmpeq_epi8(_mm_min_epu8(x,_mm_set1_epi8(31)),x);
+		__m128i q=_mm_cmpeq_epi8(x,_mm_set1_epi8('"'));
+		__m128i bs=_mm_cmpeq_epi8(x,_mm_set1_epi8('\\'));
+		return _mm_or_si128(ctl,_mm_or_si128(q,bs));
+	}
+	inline __m128i escape_special_mask(__m128i x) {
+		__m128i hi=_mm_cmpeq_epi8(_mm_max_epu8(x,_mm_set1_epi8(127)),x);
+		return _mm_or_si128(string_special_mask(x),hi);
+	}
+#endif
+#if RPOCO_AVX2
+	// byte masks for 32 characters at a time
+	inline __m256i space_mask(__m256i x) {
+		__m256i ge9=_mm256_cmpeq_epi8(_mm256_max_epu8(x,_mm256_set1_epi8(9)),x);
+		__m256i le13=_mm256_cmpeq_epi8(_mm256_min_epu8(x,_mm256_set1_epi8(13)),x);
+		return _mm256_or_si256(_mm256_cmpeq_epi8(x,_mm256_set1_epi8(' ')),_mm256_and_si256(ge9,le13));
+	}
+	inline __m256i string_special_mask(__m256i x) {
+		__m256i ctl=_mm256_cmpeq_epi8(_mm256_min_epu8(x,_mm256_set1_epi8(31)),x);
+		__m256i q=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('"'));
+		__m256i bs=_mm256_cmpeq_epi8(x,_mm256_set1_epi8('\\'));
+		return _mm256_or_si256(ctl,_mm256_or_si256(q,bs));
+	}
+	inline __m256i escape_special_mask(__m256i x) {
+		__m256i hi=_mm256_cmpeq_epi8(_mm256_max_epu8(x,_mm256_set1_epi8(127)),x);
+		return _mm256_or_si256(string_special_mask(x),hi);
+	}
+#endif
+
+	// skip whitespace, returns the first non-whitespace position (or e)
+	inline const char* skip_space(const char *p,const char *e) {
+		// tokens are mostly separated by nothing or a single space so check those first
+		if (p==e || !is_space(*p))
+			return p;
+		p++;
+		if (p==e || !is_space(*p))
+			return p;
+#if RPOCO_AVX2
+		for (;e-p>=32;p+=32) {
+			uint32_t m=(uint32_t)_mm256_movemask_epi8(space_mask(_mm256_loadu_si256((const __m256i*)p)));
+			if (m!=0xffffffffu)
+				return p+lowest_bit(~m);
+		}
+#endif
+#if RPOCO_SSE2
+		for (;e-p>=16;p+=16) {
+			uint32_t m=(uint32_t)_mm_movemask_epi8(space_mask(_mm_loadu_si128((const __m128i*)p)));
+			if (m!=0xffff)
+				return p+lowest_bit(~m&0xffff);
+		}
+#endif
+		while(p!=e && is_space(*p))
+			p++;
+		return p;
+	}
+
+	// find the end of a plain run of string characters, returns the position
+	// of the first quote, backslash or control code (or e). non_ascii is set
+	// if the run contains bytes above 127 that need UTF8 validation.
+	inline const char* scan_string(const char *p,const char *e,bool &non_ascii) {
+#if RPOCO_AVX2
+		for (;e-p>=32;p+=32) {
+			__m256i x=_mm256_loadu_si256((const __m256i*)p);
+			uint32_t m=(uint32_t)_mm256_movemask_epi8(string_special_mask(x));
+			uint32_t hi=(uint32_t)_mm256_movemask_epi8(x);
+			if (m) {
+				// only the high bytes before the terminator matters
+				non_ascii|=0!=(hi&((m&(0-m))-1));
+				return p+lowest_bit(m);
+			}
+			non_ascii|=0!=hi;
+		}
+#endif
+#if RPOCO_SSE2
+		for (;e-p>=16;p+=16) {
+			__m128i x=_mm_loadu_si128((const __m128i*)p);
+			uint32_t m=(uint32_t)_mm_movemask_epi8(string_special_mask(x));
+			uint32_t hi=(uint32_t)_mm_movemask_epi8(x);
+			if (m) {
+				non_ascii|=0!=(hi&((m&(0-m))-1));
+				return p+lowest_bit(m);
+			}
+			non_ascii|=0!=hi;
+		}
+#endif
+		for (;p!=e;p++) {
+			uint8_t c=(uint8_t)*p;
+			if (is_string_special(c))
+				break;
+			non_ascii|=c>=0x80;
+		}
+		return p;
+	}
+
+	// find the end of a run of characters that can be written to an ASCII
+	// JSON string as-is, returns the position of the first character that
+	// needs escaping (or e).
+	inline const char* scan_escape(const char *p,const char *e) {
+#if RPOCO_AVX2
+		for (;e-p>=32;p+=32) {
+			uint32_t m=(uint32_t)_mm256_movemask_epi8(escape_special_mask(_mm256_loadu_si256((const __m256i*)p)));
+			if (m)
+				return p+lowest_bit(m);
+		}
+#endif
+#if RPOCO_SSE2
+		for (;e-p>=16;p+=16) {
+			uint32_t m=(uint32_t)_mm_movemask_epi8(escape_special_mask(_mm_loadu_si128((const __m128i*)p)));
+			if (m)
+				return p+lowest_bit(m);
+		}
+#endif
+		while(p!=e && !is_escape_special((uint8_t)*p))
+			p++;
+		return p;
+	}
+
+	// skip plain ASCII bytes, returns the position of the first byte above 127 (or e)
+	inline const char* skip_ascii(const char *p,const char *e) {
+#if RPOCO_AVX2
+		for (;e-p>=32;p+=32) {
+			uint32_t hi=(uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)p));
+			if (hi)
+				return p+lowest_bit(hi);
+		}
+#endif
+#if RPOCO_SSE2
+		for (;e-p>=16;p+=16) {
+			uint32_t hi=(uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+			if (hi)
+				return p+lowest_bit(hi);
+		}
+#endif
+		while(p!=e && !(*p&0x80))
+			p++;
+		return p;
+	}
+
+	// length of the well-formed UTF8 sequence starting with the non-ASCII byte
+	// at p, 0 if it is malformed. Overlong forms, surrogates and values
+	// above U+10FFFF are rejected (the byte ranges of table 3-7 in the
+	// Unicode standard).
+	inline size_t utf8_sequence(const uint8_t *p,const uint8_t *e) {
+		uint8_t c=*p;
+		size_t n;
+		uint8_t lo=0x80,hi=0xbf; // range of the second byte
+		if (c>=0xc2 && c<=0xdf) {
+			n=2;
+		} else if (c>=0xe0 && c<=0xef) {
+			n=3;
+			if (c==0xe0)
+				lo=0xa0;
+			else if (c==0xed)
+				hi=0x9f;
+		} else if (c>=0xf0 && c<=0xf4) {
+			n=4;
+			if (c==0xf0)
+				lo=0x90;
+			else if (c==0xf4)
+				hi=0x8f;
+		} else {
+			return 0;
+		}
+		if ((size_t)(e-p)<n || p[1]<lo || p[1]>hi)
+			return 0;
+		for (size_t i=2;i<n;i++) {
+			if ((p[i]&0xc0)!=0x80)
+				return 0;
+		}
+		return n;
+	}
+
+#if RPOCO_SSSE3
+	// block-wise UTF8 validation with nibble lookup tables (Keiser and Lemire,
+	// "Validating UTF-8 In Less Than One Instruction Per Byte"). Each byte is
+	// classified together with the byte before it, the three tables flag the
+	// error kinds possible for the high and low nibble of the first byte and
+	// the high nibble of the second byte and a pair is malformed when a flag
+	// is set in all three.
+	struct utf8_tables {
+		enum : uint8_t {
+			too_short=1<<0,   // lead byte or ASCII followed by a lead byte or ASCII
+			too_long=1<<1,    // ASCII followed by a continuation
+			overlong_3=1<<2,  // E0 followed by 80..9F
+			too_large=1<<3,   // F4 followed by 90..BF, or F5..FF
+			surrogate=1<<4,   // ED followed by A0..BF
+			overlong_2=1<<5,  // C0 and C1
+			overlong_4=1<<6,  // F0 followed by 80..8F, or F5..FF followed by 80..8F
+			two_conts=1<<7,   // continuation followed by a continuation
+			carry=too_short|too_long|two_conts,
+			too_large_1000=overlong_4,
+		};
+		static const uint8_t* high1() {
+			static const uint8_t t[16]={
+				too_long,too_long,too_long,too_long,too_long,too_long,too_long,too_long,
+				two_conts,two_conts,two_conts,two_conts,
+				too_short|overlong_2,
+				too_short,
+				too_short|overlong_3|surrogate,
+				too_short|too_large|too_large_1000|overlong_4
+			};
+			return t;
+		}
+		static const uint8_t* low1() {
+			static const uint8_t t[16]={
+				carry|overlong_3|overlong_2|overlong_4,
+				carry|overlong_2,
+				carry,
+				carry,
+				carry|too_large,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000|surrogate,
+				carry|too_large|too_large_1000,
+				carry|too_large|too_large_1000
+			};
+			return t;
+		}
+		static const uint8_t* high2() {
+			static const uint8_t t[16]={
+				too_short,too_short,too_short,too_short,too_short,too_short,too_short,too_short,
+				too_long|overlong_2|two_conts|overlong_3|too_large_1000|overlong_4,
+				too_long|overlong_2|two_conts|overlong_3|too_large,
+				too_long|overlong_2|two_conts|surrogate|too_large,
+				too_long|overlong_2|two_conts|surrogate|too_large,
+				too_short,too_short,too_short,too_short
+			};
+			return t;
+		}
+	};
+
+	// validation state for 16 byte blocks
+	struct utf8_checker128 {
+		__m128i error=_mm_setzero_si128();
+		__m128i prev=_mm_setzero_si128();
+		__m128i incomplete=_mm_setzero_si128();
+		void check(__m128i in) {
+			if (!_mm_movemask_epi8(in)) {
+				// an ASCII block is only malformed if the last one ended mid-sequence
+				error=_mm_or_si128(error,incomplete);
+				incomplete=_mm_setzero_si128();
+				prev=in;
+				return;
+			}
+			__m128i nib=_mm_set1_epi8(0x0f);
+			__m128i prev1=_mm_alignr_epi8(in,prev,15);
+			__m128i sc=_mm_and_si128(_mm_and_si128(
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_tables::high1()),_mm_and_si128(_mm_srli_epi16(prev1,4),nib)),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_tables::low1()),_mm_and_si128(prev1,nib))),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)utf8_tables::high2()),_mm_and_si128(_mm_srli_epi16(in,4),nib)));
+			// bytes 2 and 3 after 3 and 4 byte leads must be continuations
+			__m128i third=_mm_subs_epu8(_mm_alignr_epi8(in,prev,14),_mm_set1_epi8((char)(0xe0-0x80)));
+			__m128i fourth=_mm_subs_epu8(_mm_alignr_epi8(in,prev,13),_mm_set1_epi8((char)(0xf0-0x80)));
+			__m128i must23=_mm_and_si128(_mm_or_si128(third,fourth),_mm_set1_epi8((char)0x80));
+			error=_mm_or_si128(error,_mm_xor_si128(must23,sc));
+			// a lead byte too close to the end continues in the next block
+			incomplete=_mm_subs_epu8(in,_mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,(char)0xef,(char)0xdf,(char)0xbf));
+			prev=in;
+		}
+		bool ok() {
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(error,_mm_setzero_si128()))==0xffff;
+		}
+	};
+#endif
+#if RPOCO_AVX2
+	// validation state for 32 byte blocks, the lookup tables are repeated in
+	// both lanes as the shuffles work within 128 bit lanes.
+	struct utf8_checker256 {
+		__m256i error=_mm256_setzero_si256();
+		__m256i prev=_mm256_setzero_si256();
+		__m256i incomplete=_mm256_setzero_si256();
+		void check(__m256i in) {
+			if (!_mm256_movemask_epi8(in)) {
+				error=_mm256_or_si256(error,incomplete);
+				incomplete=_mm256_setzero_si256();
+				prev=in;
+				return;
+			}
+			__m256i nib=_mm256_set1_epi8(0x0f);
+			// the bytes before each position, crossing from the previous block
+			__m256i carried=_mm256_permute2x128_si256(prev,in,0x21);
+			__m256i prev1=_mm256_alignr_epi8(in,carried,15);
+			__m256i sc=_mm256_and_si256(_mm256_and_si256(
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_tables::high1())),_mm256_and_si256(_mm256_srli_epi16(prev1,4),nib)),
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_tables::low1())),_mm256_and_si256(prev1,nib))),
+				_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)utf8_tables::high2())),_mm256_and_si256(_mm256_srli_epi16(in,4),nib)));
+			__m256i third=_mm256_subs_epu8(_mm256_alignr_epi8(in,carried,14),_mm256_set1_epi8((char)(0xe0-0x80)));
+			__m256i fourth=_mm256_subs_epu8(_mm256_alignr_epi8(in,carried,13),_mm256_set1_epi8((char)(0xf0-0x80)));
+			__m256i must23=_mm256_and_si256(_mm256_or_si256(third,fourth),_mm256_set1_epi8((char)0x80));
+			error=_mm256_or_si256(error,_mm256_xor_si256(must23,sc));
+			incomplete=_mm256_subs_epu8(in,_mm256_setr_epi8(
+				-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+				-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,(char)0xef,(char)0xdf,(char)0xbf));
+			prev=in;
+		}
+		bool ok() {
+			return _mm256_testz_si256(error,error)!=0;
+		}
+	};
+#endif
+
+	// check that a range of bytes is well-formed UTF8, longer ranges are
+	// checked in blocks with the lookup tables when SSSE3 is available.
+	inline bool validate_utf8(const char *s,const char *e) {
+#if RPOCO_SSSE3
+		if (e-s>=64) {
+			// the tail is checked as a zero padded block, the zeros (ASCII) make
+			// a sequence that is cut off at the end fail.
+			uint8_t tail[32]={0};
+#if RPOCO_AVX2
+			utf8_checker256 chk;
+			for (;e-s>=32;s+=32)
+				chk.check(_mm256_loadu_si256((const __m256i*)s));
+			memcpy(tail,s,e-s);
+			chk.check(_mm256_loadu_si256((const __m256i*)tail));
+#else
+			utf8_checker128 chk;
+			for (;e-s>=16;s+=16)
+				chk.check(_mm_loadu_si128((const __m128i*)s));
+			memcpy(tail,s,e-s);
+			chk.check(_mm_loadu_si128((const __m128i*)tail));
+#endif
+			return chk.ok();
+		}
+#endif
+		// short ranges are checked one sequence at a time
+		const uint8_t *p=(const uint8_t*)s,*pe=(const uint8_t*)e;
+		while(p!=pe) {
+			// plain ASCII runs are skipped in bulk
+			p=(const uint8_t*)skip_ascii((const char*)p,e);
+			if (p==pe)
+				break;
+			size_t n=utf8_sequence(p,pe);
+			if (!n)
+				return false;
+			p+=n;
+		}
+		return true;
+	}
+};
+
+#endif // __INCLUDED_RPOCOSIMD_HPP__
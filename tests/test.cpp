@@ -12,9 +12,7 @@
 #include <rpoco/rpocojson.hpp>
 
 
-// Note: we probably need some #ifdefs to work with other compilers than MSVC2013
-//       since <filesystem> has been standardized since the release of this compiler.
-using namespace std::tr2::sys;
+using namespace std::filesystem;
 
 using namespace rpocojson;
 
@@ -34,13 +32,17 @@ int main(int argc,char **argv) {
 		if (it->path().extension()!=".json")
 			continue;
 
-		bool wanted=0==it->path().filename().find("valid-");
-		bool extWanted = 0 == it->path().filename().find("ext-valid-");
-		bool doExt = extWanted || (0==it->path().filename().find("ext-invalid-"));
+		std::string name=it->path().filename().string();
+		bool wanted=0==name.find("valid-");
+		bool extWanted = 0 == name.find("ext-valid-");
+		bool doExt = extWanted || (0==name.find("ext-invalid-"));
 
+		parse_options opts;
 		for (int i = 0; i< (doExt ? 2 : 1); i++) {
+			opts.allow_c_comments = i==1;
 			json_value *jv = 0;
-			bool pr = parse(std::ifstream(it->path().string().c_str()),jv,i==1);	
+			std::ifstream is(it->path());
+			bool pr = parse(is,jv,opts);
 			bool curWanted = (i == 1 ? extWanted : wanted);
 			if (curWanted == pr) {
 				printf("%s was %s as expected%s\n",it->path().string().c_str(),pr ? "parsed" : "not parsed",i==1?" with extensions":"");
@@ -48,7 +50,7 @@ int main(int argc,char **argv) {
 					std::string outname = it->path().string() + ".out";
 					{
 						std::ofstream os(outname);
-						os << to_json(jv);
+						to_json(jv,os);
 					}
 					std::string cmd = "node json_diff.js " + it->path().string() + " " + outname;
 					std::system(cmd.c_str());
@@ -58,6 +60,14 @@ int main(int argc,char **argv) {
 				printf("parsed ok?:%s wanted:%s to:%s\n",pr ? "true" : "false",curWanted ? "t" : "f",to_json(jv).c_str());
 				return -1;
 			}
+			// the tape should hold the same document
+			json_tape tape;
+			std::ifstream tis(it->path());
+			bool tr = parse(tis,tape,opts);
+			if (tr != pr || (pr && to_json(tape) != to_json(jv))) {
+				printf("Error, %s was read differently into a tape\n",it->path().string().c_str());
+				return -1;
+			}
 			if (jv)
 				delete jv;
 		}
@@ -0,0 +1,247 @@
+// test_features.cpp
+//
+// round trips through the writer modes and output forms, checking that
+// every form gives back the same objects and the same text.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <rpoco/rpocojson.hpp>
+
+using namespace rpocojson;
+
+struct inner {
+	int a=0;
+	std::string s="default";
+	RPOCO(a,s);
+};
+
+struct point {
+	double x=0,y=0;
+	RPOCO(x,y);
+};
+
+// points are always written as [x,y]
+namespace rpoco {
+	template<> struct positional_encoding<point> : std::true_type {};
+}
+
+struct record {
+	int id=1;
+	double value=0.5;
+	std::string name;
+	inner in;
+	std::vector<inner> list;
+	std::vector<point> points;
+	std::map<std::string,inner> named;
+	std::vector<std::string> tags;
+	json_value extra;
+	RPOCO(id,value,name,in,list,points,named,tags,extra);
+};
+
+struct pmr_record {
+	std::pmr::string name;
+	std::pmr::vector<std::pmr::string> tags;
+	std::pmr::vector<int> nums;
+	RPOCO(name,tags,nums);
+};
+
+static int failures=0;
+
+static void check(bool ok,const char *what,const std::string &detail=std::string()) {
+	if (ok)
+		return;
+	printf("Error, %s %s\n",what,detail.c_str());
+	failures++;
+}
+
+static record make_record() {
+	record r;
+	r.id=42;
+	r.value=-1234.5678e-9;
+	r.name="a name long enough to be referenced by the scatter-gather output, with \"quotes\"";
+	r.in.a=3;
+	for (int i=0;i<20;i++) {
+		inner in;
+		in.a=i%3;
+		if (i%2)
+			in.s="item "+std::to_string(i);
+		r.list.push_back(in);
+		r.points.push_back(point{i*0.25,-i*1e10});
+	}
+	r.named["first"].a=1;
+	r.named["second"].s=std::string(300,'x');
+	r.tags={"a","",std::string(5000,'t'),"\xc3\xa9\ttab"};
+	parse("{\"k\":[1,2.5,\"s\",null,true,{\"n\":{}}],\"e\":[]}",r.extra);
+	return r;
+}
+
+// read the whole output of a pull writer in small pieces
+template<typename X> std::string pull(X &x,const write_options &opts,size_t piece) {
+	json_pull_writer pw(x,opts);
+	std::string out;
+	std::vector<char> buf(piece);
+	while(size_t n=pw.read(buf.data(),buf.size()))
+		out.append(buf.data(),n);
+	check(pw.done(),"pull writer not done after the last read");
+	return out;
+}
+
+static void numbers() {
+	// the shortest representation written must read back to the same bits
+	std::mt19937_64 rng(1);
+	for (int i=0;i<200000;i++) {
+		uint64_t bits=rng();
+		if (i%4==0)
+			bits&=0x800fffffffffffffULL|(uint64_t)(rng()%3)<<52; // subnormals and tiny values
+		double d;
+		memcpy(&d,&bits,sizeof d);
+		if (!std::isfinite(d))
+			continue;
+		std::string text=to_json(d);
+		double back=0;
+		if (!parse(text,back) || memcmp(&back,&d,sizeof d)) {
+			check(false,"number round trip",text);
+			break;
+		}
+	}
+	static const double edge[]={0.0,-0.0,1.0,0.1,1e23,5e-324,2.2250738585072014e-308,1.7976931348623157e308,9007199254740993.0,123456789.0};
+	for (double d:edge) {
+		std::string text=to_json(d);
+		double back=0;
+		check(parse(text,back) && memcmp(&back,&d,sizeof d)==0,"number round trip",text);
+	}
+	for (int i:{0,1,-1,2147483647,-2147483647-1}) {
+		int back=0;
+		check(parse(to_json(i),back) && back==i,"integer round trip",to_json(i));
+	}
+}
+
+static void modes() {
+	record r=make_record();
+	std::string plain=to_json(r);
+	// every mode (and combination) parses back into the same objects
+	for (int mode=0;mode<8;mode++) {
+		write_options opts;
+		opts.omit_defaults=(mode&1)!=0;
+		opts.positional=(mode&2)!=0;
+		opts.columnar=(mode&4)!=0;
+		std::string text=to_json(r,opts);
+		record back;
+		check(parse(text,back) && to_json(back)==plain,"mode round trip",std::to_string(mode)+": "+text.substr(0,200));
+		// the pull writer produces the same text in any piece size
+		for (size_t piece:{1,3,64,100000})
+			check(pull(r,opts,piece)==text,"pull writer output differs",std::to_string(mode)+" "+std::to_string(piece));
+		// the modes also apply when visiting through the abstract visitor
+		json_writer w(0,opts);
+		rpoco::visit<record>(w,r);
+		check(w.out==text,"virtual visitor output differs",std::to_string(mode)+": "+w.out.substr(0,200));
+	}
+	write_options omit;
+	omit.omit_defaults=true;
+	inner def;
+	check(to_json(def,omit)=="{}","omit-defaults wrote default members",to_json(def,omit));
+	// also when visiting through the abstract visitor
+	json_writer ow(0,omit);
+	rpoco::visit<inner>(ow,def);
+	check(ow.out=="{}","omit-defaults through a visitor wrote default members",ow.out);
+	write_options positional;
+	positional.positional=true;
+	point p{1.5,-2};
+	check(to_json(p)=="[1.5,-2]","positional encoding",to_json(p));
+	check(to_json(r.in,positional)=="[3,\"default\"]","positional option",to_json(r.in,positional));
+	// through the abstract visitor
+	json_writer vw(0,positional);
+	rpoco::visit<inner>(vw,r.in);
+	check(vw.out=="[3,\"default\"]","positional option through a visitor",vw.out);
+	json_writer pw;
+	rpoco::visit<point>(pw,p);
+	check(pw.out=="[1.5,-2]","positional encoding through a visitor",pw.out);
+}
+
+static void outputs() {
+	record r=make_record();
+	for (int raw=0;raw<2;raw++) {
+		write_options opts;
+		opts.raw_utf8=raw!=0;
+		std::string text=to_json(r,opts);
+		// scatter-gather output
+		json_iovec iov;
+		to_json(r,iov,opts);
+		check(iov.str()==text,"iovec output differs");
+		check(iov.size()==text.size(),"iovec size differs");
+		// reusing the iovec gives the same output
+		to_json(r,iov,opts);
+		check(iov.str()==text,"reused iovec output differs");
+		// sinks with different block sizes and caller buffers
+		for (size_t block:{1,7,4096,1<<20}) {
+			std::string out;
+			string_sink sink(out);
+			opts.block_size=block;
+			check(to_json(r,sink,opts) && out==text,"sink output differs",std::to_string(block));
+		}
+		std::vector<char> buf(text.size());
+		check(to_json(r,buf.data(),buf.size(),opts)==text.size() && std::string(buf.data(),buf.size())==text,"buffer output differs");
+		char small[16];
+		check(to_json(r,small,sizeof small,opts)==text.size() && memcmp(small,text.data(),sizeof small)==0,"short buffer output differs");
+	}
+}
+
+static void memory() {
+	std::string doc="{\"name\":\"a long name that is not stored inline\",\"tags\":[\"x\\ny\",\"a plain tag text here\",\"z\"],\"nums\":[1,2,3]}";
+	rpoco::arena a(4096);
+	for (int round=0;round<3;round++) {
+		// pmr members are created on the arena
+		{
+			pmr_record p;
+			check(parse(doc,p,a) && to_json(p)==doc,"pmr parse on an arena",to_json(p));
+			check(p.tags.get_allocator().resource()==&a && p.tags[1].get_allocator().resource()==&a,"pmr containers not on the arena");
+		}
+		// json_value trees are allocated from the arena and dropped with it
+		json_value jv;
+		check(parse(doc,jv,a) && to_json(jv)==doc,"json_value parse on an arena",to_json(jv));
+		jv.release();
+		a.reset();
+	}
+	// other memory resources
+	std::pmr::monotonic_buffer_resource mono;
+	json_value jv;
+	check(parse(doc,jv,mono) && to_json(jv)==doc,"json_value parse on a monotonic resource");
+	jv.release();
+	pmr_record p;
+	check(parse(doc,p) && to_json(p)==doc,"pmr parse without a resource");
+	// values can be assigned from values they own
+	json_value tree;
+	parse("[[1,\"a string that is not stored inline\",{\"k\":[2,3]}],4]",tree);
+	tree=std::move((*tree.array())[0]);
+	check(to_json(tree)=="[1,\"a string that is not stored inline\",{\"k\":[2,3]}]","move from a child",to_json(tree));
+	tree=(*tree.array())[2];
+	check(to_json(tree)=="{\"k\":[2,3]}","copy from a child",to_json(tree));
+	// and from strings they hold, both inline and allocated
+	parse("[\"a string that is not stored inline\",\"short\"]",tree);
+	tree=(*tree.array())[0].str();
+	check(to_json(tree)=="\"a string that is not stored inline\"","string from a child",to_json(tree));
+	tree=tree.str();
+	check(to_json(tree)=="\"a string that is not stored inline\"","string from itself",to_json(tree));
+	tree="tiny";
+	tree=tree.str();
+	check(to_json(tree)=="\"tiny\"","inline string from itself",to_json(tree));
+}
+
+int main() {
+	numbers();
+	modes();
+	outputs();
+	memory();
+	if (failures) {
+		printf("%d feature checks failed\n",failures);
+		return -1;
+	}
+	printf("feature checks passed\n");
+	return 0;
+}
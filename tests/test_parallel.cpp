@@ -0,0 +1,117 @@
+// test_parallel.cpp
+//
+// writes documents of many sizes with several threads and checks that
+// the output is identical to writing them on a single thread.
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rpoco/rpocojson.hpp>
+
+using namespace rpocojson;
+
+struct item {
+	int id=0;
+	std::string name;
+	std::vector<int> values;
+	RPOCO(id,name,values);
+};
+
+struct document {
+	std::vector<item> items;
+	std::map<std::string,item> named;
+	std::vector<std::vector<int>> rows;
+	json_value tree;
+	RPOCO(items,named,rows,tree);
+};
+
+static document make_document(size_t sz) {
+	document doc;
+	for (size_t i=0;i<sz;i++) {
+		item it;
+		it.id=(int)i;
+		it.name="item "+std::to_string(i*7919%1000)+(i%5 ? "" : " with \"quotes\" and \xc3\xa9");
+		it.values.assign(i%9,(int)i);
+		doc.items.push_back(it);
+		if (i%3==0)
+			doc.named["k"+std::to_string(i)]=it;
+		if (i%4==0)
+			doc.rows.push_back(it.values);
+	}
+	std::string text="[";
+	for (size_t i=0;i<sz;i++)
+		text+=std::string(i ? "," : "")+"{\"n\":"+std::to_string(i)+",\"a\":[1,\"two\",null,{}]}";
+	text+="]";
+	parse(text,doc.tree);
+	return doc;
+}
+
+// the text written through a sink with small blocks
+static std::string write_blocks(document &doc,const write_options &opts) {
+	std::string out;
+	string_sink sink(out);
+	write_options o=opts;
+	o.block_size=100;
+	to_json(doc,sink,o);
+	return out;
+}
+
+int main() {
+	static const size_t sizes[]={0,1,2,3,7,64,500,1023,1024,1025,5000};
+	static const unsigned threads[]={2,3,4,8};
+	static const size_t parallel_mins[]={1,2,16,1024};
+	int failures=0;
+	for (size_t sz:sizes) {
+		document doc=make_document(sz);
+		for (int mode=0;mode<4;mode++) {
+			write_options serial;
+			serial.raw_utf8=mode&1;
+			serial.columnar=(mode&2)!=0;
+			std::string expected=to_json(doc,serial);
+			for (unsigned t:threads) {
+				for (size_t pm:parallel_mins) {
+					write_options opts=serial;
+					opts.threads=t;
+					opts.parallel_min=pm;
+					if (to_json(doc,opts)!=expected || write_blocks(doc,opts)!=expected) {
+						printf("Error, %zu elements written on %u threads (parallel_min %zu, mode %d) differ from the serial output\n",sz,t,pm,mode);
+						failures++;
+					}
+				}
+			}
+		}
+	}
+
+	// several callers writing at the same time share the worker pool
+	document doc=make_document(3000);
+	std::string expected=to_json(doc);
+	std::vector<std::thread> callers;
+	std::atomic<int> mismatches{0};
+	for (unsigned c=0;c<4;c++) {
+		callers.emplace_back([&doc,&expected,&mismatches,c] {
+			write_options opts;
+			opts.threads=2+c;
+			opts.parallel_min=16;
+			for (int i=0;i<20;i++) {
+				if (to_json(doc,opts)!=expected)
+					mismatches++;
+			}
+		});
+	}
+	for (std::thread &t:callers)
+		t.join();
+	if (mismatches) {
+		printf("Error, %d concurrent parallel writes differ from the serial output\n",(int)mismatches);
+		failures++;
+	}
+
+	if (failures) {
+		printf("%d parallel writer checks failed\n",failures);
+		return -1;
+	}
+	printf("parallel writer checks passed\n");
+	return 0;
+}
@@ -0,0 +1,116 @@
+// test_utf8.cpp
+//
+// checks that malformed UTF8 is rejected by the validator and the parser
+// and that the writer replaces it instead of passing it on.
+
+#include <cstdio>
+#include <string>
+
+#include <rpoco/rpocojson.hpp>
+
+using namespace rpocojson;
+
+static int failures=0;
+
+static void check(bool ok,const char *what,const std::string &data) {
+	if (ok)
+		return;
+	printf("Error, %s:",what);
+	for (unsigned char c:data)
+		printf(" %02X",c);
+	printf("\n");
+	failures++;
+}
+
+static bool valid(const std::string &s) {
+	return rpoco::validate_utf8(s.data(),s.data()+s.size());
+}
+
+// malformed sequences, each is also checked inside longer text so that
+// the block-wise validation sees it at different positions in a block
+static const char *invalid[]={
+	"\x80",                 // lone continuation
+	"\xbf\x80",
+	"\xc0\x80",             // overlong 2 byte forms
+	"\xc1\xbf",
+	"\xe0\x80\x80",         // overlong 3 byte forms
+	"\xe0\x9f\xbf",
+	"\xed\xa0\x80",         // surrogates
+	"\xed\xbf\xbf",
+	"\xf0\x80\x80\x80",     // overlong 4 byte forms
+	"\xf0\x8f\xbf\xbf",
+	"\xf4\x90\x80\x80",     // above U+10FFFF
+	"\xf5\x80\x80\x80",
+	"\xf7\xbf\xbf\xbf",
+	"\xf8\x88\x80\x80\x80", // 5 and 6 byte forms
+	"\xfc\x84\x80\x80\x80\x80",
+	"\xfe",
+	"\xff",
+	"\xc3",                 // cut off sequences
+	"\xe2\x82",
+	"\xf0\x9f\x98",
+	"\xe2\x28\xa1",         // missing continuations
+	"\xf0\x9f\x28\x80",
+};
+
+int main() {
+	// every scalar value is accepted and surrogates are not
+	for (uint32_t c=0;c<=0x10ffff;c++) {
+		std::string s;
+		dump_utf8(s,c);
+		bool surrogate=c>=0xd800 && c<0xe000;
+		if (valid(s)==surrogate)
+			check(false,"wrong validation of an encoded value",s);
+	}
+	std::string good="plain \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf \xed\x9f\xbf \xee\x80\x80";
+	for (size_t pad=0;pad<70;pad++) {
+		std::string text=std::string(pad,'a')+good+std::string(pad,'b');
+		check(valid(text),"valid text rejected",text);
+	}
+
+	for (const char *bad:invalid) {
+		std::string seq=bad;
+		for (size_t pad=0;pad<70;pad+=pad<40 ? 1 : 7) {
+			std::string text=std::string(pad,'a')+seq;
+			check(!valid(text),"malformed text accepted",text);
+			text+=std::string(pad,'b');
+			check(!valid(text),"malformed text accepted",text);
+			text+=good;
+			check(!valid(text),"malformed text accepted",text);
+		}
+
+		// the parser rejects the bytes inside strings and member names
+		std::string str;
+		json_value *jv=0;
+		std::string doc="\"x"+seq+"y\"";
+		check(!parse(doc,str),"parser accepted malformed text",doc);
+		doc="{\"a"+seq+"\":1}";
+		check(!parse(doc,jv),"parser accepted a malformed name",doc);
+		delete jv;
+
+		// the writer outputs the replacement character for the bytes
+		std::string s="x"+seq+"y";
+		std::string out=to_json(s);
+		check(out.find("\\uFFFD")!=std::string::npos,"malformed text not replaced",out);
+		check(valid(out),"written text is malformed",out);
+		write_options raw;
+		raw.raw_utf8=true;
+		out=to_json(s,raw);
+		check(out.find("\xef\xbf\xbd")!=std::string::npos,"malformed text not replaced in raw output",out);
+		check(valid(out),"raw written text is malformed",out);
+	}
+
+	// well-formed text survives a round trip in both output modes
+	std::string back,raw_back;
+	check(parse(to_json(good),back) && back==good,"escaped round trip",good);
+	write_options raw;
+	raw.raw_utf8=true;
+	check(parse(to_json(good,raw),raw_back) && raw_back==good,"raw round trip",good);
+
+	if (failures) {
+		printf("%d UTF8 checks failed\n",failures);
+		return -1;
+	}
+	printf("UTF8 checks passed\n");
+	return 0;
+}